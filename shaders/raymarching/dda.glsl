@@ -12,5 +12,16 @@ vec3 ddaExit(vec3 pos, vec3 rd, ivec3 cell, float cellSize) {
     return pos + rd * (tExit + 1e-3);
 }
 
+// One step of the grid traversal: crosses the nearest cell boundary, sets t to
+// the ray distance of that boundary and returns the axis crossed.
+int ddaStep(inout ivec3 cell, inout vec3 tMax, vec3 tDelta, ivec3 istep, out float t) {
+    if (tMax.x < tMax.y) {
+        if (tMax.x < tMax.z) { t = tMax.x; tMax.x += tDelta.x; cell.x += istep.x; return 0; }
+        t = tMax.z; tMax.z += tDelta.z; cell.z += istep.z; return 2;
+    }
+    if (tMax.y < tMax.z) { t = tMax.y; tMax.y += tDelta.y; cell.y += istep.y; return 1; }
+    t = tMax.z; tMax.z += tDelta.z; cell.z += istep.z; return 2;
+}
+
 #endif
 
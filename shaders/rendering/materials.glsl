@@ -1,23 +1,43 @@
 #ifndef TOHA_MATERIALS_GLSL
 #define TOHA_MATERIALS_GLSL
 
-#include "world/noise.glsl"
+#include "world/terrain.glsl"
 
-const int MAT_METAL_LIGHT = 0;
-const int MAT_METAL_DARK = 1;
-const int MAT_RUST = 2;
-const int MAT_GRIME = 3;
-const int MAT_PIPE = 4;
-const int MAT_GRATING = 5;
+// Structure materials, numbered after the terrain ones in world/cells.glsl.
+const int MAT_METAL_LIGHT = 3;
+const int MAT_METAL_DARK = 4;
+const int MAT_RUST = 5;
+const int MAT_GRIME = 6;
+const int MAT_PIPE = 7;
+const int MAT_GRATING = 8;
 
-int getMaterial(vec3 p, ivec3 cell) {
-    float rust = fbm(p * 0.02, 3);
-    float grime = fbm(p * 0.1 + 100.0, 2);
+// Parts of a prefab voxel (world/structures.glsl); 0 is empty.
+const int PART_FRAME = 1;
+const int PART_PIPE = 2;
+const int PART_GRATING = 3;
+
+// fbm over simplex3 remapped to about [0, 1].
+float materialNoise(vec3 p, int octaves) {
+    float value = 0.0;
+    float amp = 0.5;
+    for (int i = 0; i < octaves; i++) {
+        value += amp * simplex3(p);
+        p *= 2.0;
+        amp *= 0.5;
+    }
+    return 0.5 + 0.5 * value;
+}
+
+// Only evaluated for the voxel a ray hits, so the noise costs one lookup per
+// pixel rather than one per step.
+int getMaterial(vec3 p, ivec3 cell, int part) {
+    float rust = materialNoise(p * 0.02, 3);
+    float grime = materialNoise(p * 0.1 + 100.0, 2);
     if (rust > 0.7) return MAT_RUST;
     if (grime > 0.65) return MAT_GRIME;
+    if (part == PART_GRATING) return MAT_GRATING;
+    if (part == PART_PIPE) return MAT_PIPE;
     float r = hash11(float(cell.x * 12 + cell.y * 31 + cell.z * 7));
-    if (r > 0.8) return MAT_GRATING;
-    if (r > 0.6) return MAT_PIPE;
     return r > 0.35 ? MAT_METAL_DARK : MAT_METAL_LIGHT;
 }
 
@@ -31,4 +51,3 @@ vec3 materialColor(int mat) {
 }
 
 #endif
-
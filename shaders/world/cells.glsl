@@ -0,0 +1,43 @@
+#ifndef TOHA_CELLS_GLSL
+#define TOHA_CELLS_GLSL
+
+// Voxel classification against the terrain height field. Every shader that
+// includes this defines the height lookup: cube.comp reads the height cache,
+// the kernel benchmark evaluates the terrain directly.
+float cachedTerrainHeight(vec2 p);
+
+const int MAT_AIR = -1;
+const int MAT_GRASS = 0;
+const int MAT_DIRT = 1;
+const int MAT_STONE = 2;
+
+int cellType(ivec3 cell) {
+    float h = cachedTerrainHeight(vec2(cell.x, cell.z));
+    float depth = h - float(cell.y);
+    if (depth < 0.0) return MAT_AIR;
+    if (depth < 1.0) return MAT_GRASS;
+    if (depth < 4.0) return MAT_DIRT;
+    return MAT_STONE;
+}
+
+int cellCheckLOD(ivec3 cell, int lod) {
+    float cellSize = float(1 << lod);
+    vec3 cellMin = vec3(cell) * cellSize;
+    vec3 cellMax = cellMin + cellSize;
+    vec3 cellMid = (cellMin + cellMax) * 0.5;
+    
+    float h00 = cachedTerrainHeight(cellMin.xz);
+    float h10 = cachedTerrainHeight(vec2(cellMax.x, cellMin.z));
+    float h01 = cachedTerrainHeight(vec2(cellMin.x, cellMax.z));
+    float h11 = cachedTerrainHeight(cellMax.xz);
+    float hMid = cachedTerrainHeight(cellMid.xz);
+    
+    float hMax = max(max(max(h00, h10), max(h01, h11)), hMid) + cellSize;
+    
+    if (cellMin.y > hMax) return -1;
+    
+    if (lod == 0) return cellType(cell);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef TOHA_HEIGHT_CACHE_GLSL
+#define TOHA_HEIGHT_CACHE_GLSL
+
+// Terrain height clipmap: up to HEIGHT_CACHE_MAX_LEVELS nested grids of RES x RES
+// samples centred on the same snapped camera position, level L spaced 2^L metres
+// apart. Two slots are kept so one can be rebuilt while the other is being read.
+// The host lowers the level count when device memory runs short, so the slot
+// stride depends on the current count.
+const int HEIGHT_CACHE_RES = 512;
+const int HEIGHT_CACHE_MAX_LEVELS = 4;
+
+ivec2 heightCacheOrigin(ivec2 center, int level) {
+    return center - (HEIGHT_CACHE_RES / 2) * (1 << level);
+}
+
+int heightCacheIndex(int slot, int level, ivec2 texel, int levels) {
+    return ((slot * levels + level) * HEIGHT_CACHE_RES + texel.y) * HEIGHT_CACHE_RES + texel.x;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef TOHA_MICRO_GLSL
+#define TOHA_MICRO_GLSL
+
+// Sub-voxel detail of a surface voxel: a 4x4x4 occupancy bitmask, bit
+// x + 4z + 16y, so each quarter-height layer is 16 bits and the whole mask
+// fits a uvec2 (layers 0-1 in x, 2-3 in y). Instead of a DDA through the 64
+// sub-voxels, the ray visits at most the four layers, masks each one with
+// the columns its segment can reach and tests only the set bits that remain.
+
+const float MICRO_SIZE = 0.25;
+
+uvec4 microHash(ivec3 cell) {
+    uvec4 v = uvec4(uvec3(cell), 0x9e3779b9u) * 1664525u + 1013904223u;
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+    v ^= v >> 16u;
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+    return v;
+}
+
+// A closed bottom layer and tufts that thin out towards the top: every layer
+// is a subset of the one below, about 3/4, 3/8 and 3/16 of the columns.
+uvec2 microMask(ivec3 cell) {
+    uvec4 h = microHash(cell);
+    uint l1 = (h.x | h.y) & 0xFFFFu;
+    uint l2 = l1 & h.z & 0xFFFFu;
+    uint l3 = l2 & h.w & 0xFFFFu;
+    return uvec2(0xFFFFu | (l1 << 16), l2 | (l3 << 16));
+}
+
+uint microLayer(uvec2 mask, int y) {
+    return ((y < 2 ? mask.x : mask.y) >> (16 * (y & 1))) & 0xFFFFu;
+}
+
+// Columns of a layer the ray segment [t0, t1] can touch: the bounding
+// rectangle of the segment, one row of bits repeated over the rows it spans.
+uint microFootprint(vec3 ro, vec3 rd, vec3 base, float t0, float t1) {
+    vec2 p0 = (ro.xz + rd.xz * t0 - base.xz) / MICRO_SIZE;
+    vec2 p1 = (ro.xz + rd.xz * t1 - base.xz) / MICRO_SIZE;
+    ivec2 a = clamp(ivec2(floor(min(p0, p1))), ivec2(0), ivec2(3));
+    ivec2 b = clamp(ivec2(floor(max(p0, p1))), ivec2(0), ivec2(3));
+    uint row = (2u << b.x) - (1u << a.x);
+    uint rows = (0xFFFFu << (4 * a.y)) & (0xFFFFu >> (4 * (3 - b.y)));
+    return (row * 0x1111u) & rows;
+}
+
+// Intersects the ray with the set sub-voxels of `cell` between tEnter and
+// tExit, where it enters and leaves the voxel. On a hit, tHit and the face
+// normal are set; a ray through empty sub-voxels only returns false.
+bool traceMicro(vec3 ro, vec3 rd, ivec3 cell, float tEnter, float tExit, out float tHit, out vec3 normal) {
+    uvec2 mask = microMask(cell);
+    vec3 base = vec3(cell);
+    vec3 invRd = 1.0 / rd;
+    int yFirst = rd.y >= 0.0 ? 0 : 3;
+    int yStep = rd.y >= 0.0 ? 1 : -1;
+
+    for (int i = 0; i < 4; ++i) {
+        int y = yFirst + i * yStep;
+        float ta = (base.y + float(y) * MICRO_SIZE - ro.y) * invRd.y;
+        float tb = (base.y + float(y + 1) * MICRO_SIZE - ro.y) * invRd.y;
+        float t0 = max(tEnter, min(ta, tb));
+        float t1 = min(tExit, max(ta, tb));
+        if (t0 > t1) continue;
+
+        uint bits = microLayer(mask, y) & microFootprint(ro, rd, base, t0, t1);
+        // Boxes do not overlap, so the nearest entry among the candidates is
+        // the first one the ray meets.
+        float best = tExit + 1.0;
+        while (bits != 0u) {
+            int b = findLSB(bits);
+            bits &= bits - 1u;
+            vec3 boxMin = base + vec3(float(b & 3), float(y), float(b >> 2)) * MICRO_SIZE;
+            vec3 tLo = (boxMin - ro) * invRd;
+            vec3 tHi = (boxMin + MICRO_SIZE - ro) * invRd;
+            vec3 tNear = min(tLo, tHi);
+            vec3 tFar = max(tLo, tHi);
+            float tn = max(max(tNear.x, tNear.y), tNear.z);
+            float tf = min(min(tFar.x, tFar.y), tFar.z);
+            if (tn > tf || tf < t0 || tn >= best) continue;
+            best = tn;
+            if (tn == tNear.x) normal = vec3(-sign(rd.x), 0.0, 0.0);
+            else if (tn == tNear.y) normal = vec3(0.0, -sign(rd.y), 0.0);
+            else normal = vec3(0.0, 0.0, -sign(rd.z));
+        }
+        if (best <= tExit) {
+            tHit = max(best, tEnter);
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
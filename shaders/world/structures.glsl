@@ -0,0 +1,143 @@
+#ifndef TOHA_STRUCTURES_GLSL
+#define TOHA_STRUCTURES_GLSL
+
+// Prefab industrial structures (pipe racks, towers, catwalks, tanks) standing
+// on the terrain. The world is split into STRUCTURE_GRID metre squares; a hash
+// of the square decides whether it holds a structure, which prefab, where in
+// the square and in which of four quarter turns, and the terrain height at the
+// footprint's centre sets the base. The prefabs are voxel models in a brick
+// atlas built by the host (compute/structures.cpp). Word 0 is the model count,
+// words 4 + 4m hold model m's size and the offset of its brick table, which has
+// one word per 8x8x8 brick: STRUCTURE_EMPTY_BRICK, or the offset of 32 words
+// with two bits per voxel (bit pair x + 8y + 64z), the part the voxel belongs
+// to (PART_* in rendering/materials.glsl, 0 = empty).
+//
+// Every shader that includes this defines the atlas and density lookups, as
+// for the height lookup in cells.glsl.
+uint structureAtlasWord(uint index);
+float structureDensity();
+
+const int STRUCTURE_GRID_SHIFT = 6;
+const int STRUCTURE_GRID = 1 << STRUCTURE_GRID_SHIFT;
+// Largest prefab height, and how far a base is sunk into the ground so legs
+// still reach it on a slope. Both must match compute/structures.cpp.
+const int STRUCTURE_MAX_HEIGHT = 48;
+const int STRUCTURE_SINK = 2;
+// Nothing is above this: the highest terrain plus the tallest prefab.
+const int STRUCTURE_TOP = int(TERRAIN_BASE + TERRAIN_AMP) + STRUCTURE_MAX_HEIGHT;
+// Words before the model table; must match compute/structures.cpp.
+const uint STRUCTURE_HEADER_WORDS = 4u;
+const uint STRUCTURE_EMPTY_BRICK = 0xFFFFFFFFu;
+
+struct StructureInstance {
+    int model;       // -1 = the square is empty
+    int rotation;    // quarter turns about y
+    ivec3 origin;    // minimum corner of the placed prefab
+    ivec3 extent;    // its size after the rotation
+};
+
+// Rays walk through few squares, so the last one looked up is kept; that
+// spares the terrain lookup for the base on almost every call.
+ivec2 structureMemoSquare = ivec2(0x7FFFFFFF);
+StructureInstance structureMemo;
+
+uvec4 structureHash(ivec2 square) {
+    uvec4 v = uvec4(uvec2(square), 0x27d4eb2fu, 0x165667b1u) * 1664525u + 1013904223u;
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+    v ^= v >> 16u;
+    v.x += v.y * v.w;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v.w += v.y * v.z;
+    return v;
+}
+
+ivec3 structureModelSize(int model) {
+    uint base = STRUCTURE_HEADER_WORDS + 4u * uint(model);
+    return ivec3(structureAtlasWord(base), structureAtlasWord(base + 1u), structureAtlasWord(base + 2u));
+}
+
+StructureInstance structureAt(ivec2 square) {
+    if (square == structureMemoSquare) return structureMemo;
+    StructureInstance s;
+    s.model = -1;
+    s.rotation = 0;
+    s.origin = ivec3(0);
+    s.extent = ivec3(0);
+
+    uvec4 h = structureHash(square);
+    uint models = structureAtlasWord(0u);
+    if (models > 0u && float(h.x >> 8u) * (1.0 / 16777216.0) < structureDensity()) {
+        s.model = int(h.y % models);
+        s.rotation = int(h.z & 3u);
+        ivec3 size = structureModelSize(s.model);
+        s.extent = (s.rotation & 1) != 0 ? size.zyx : size;
+        uvec2 slack = uvec2(max(ivec2(STRUCTURE_GRID) - s.extent.xz + 1, ivec2(1)));
+        ivec2 corner = square * STRUCTURE_GRID + ivec2((h.zw >> 8u) % slack);
+        float ground = cachedTerrainHeight(vec2(corner + s.extent.xz / 2));
+        s.origin = ivec3(corner.x, int(floor(ground)) + 1 - STRUCTURE_SINK, corner.y);
+    }
+    structureMemoSquare = square;
+    structureMemo = s;
+    return s;
+}
+
+// The part of the structure voxel `cell` belongs to, 0 if none.
+int structurePart(ivec3 cell) {
+    if (structureDensity() <= 0.0 || cell.y > STRUCTURE_TOP) return 0;
+    StructureInstance s = structureAt(cell.xz >> STRUCTURE_GRID_SHIFT);
+    if (s.model < 0) return 0;
+    ivec3 d = cell - s.origin;
+    if (any(lessThan(d, ivec3(0))) || any(greaterThanEqual(d, s.extent))) return 0;
+
+    ivec3 local = d;
+    if (s.rotation == 1) local.xz = ivec2(d.z, s.extent.x - 1 - d.x);
+    else if (s.rotation == 2) local.xz = s.extent.xz - 1 - d.xz;
+    else if (s.rotation == 3) local.xz = ivec2(s.extent.z - 1 - d.z, d.x);
+
+    ivec3 bricks = (structureModelSize(s.model) + 7) >> 3;
+    ivec3 b = local >> 3;
+    uint table = structureAtlasWord(STRUCTURE_HEADER_WORDS + 4u * uint(s.model) + 3u);
+    uint brick = structureAtlasWord(table + uint(b.x + bricks.x * (b.y + bricks.y * b.z)));
+    if (brick == STRUCTURE_EMPTY_BRICK) return 0;
+    ivec3 v = local & 7;
+    int bit = v.x + 8 * v.y + 64 * v.z;
+    return int(structureAtlasWord(brick + uint(bit >> 4)) >> uint(2 * (bit & 15))) & 3;
+}
+
+// A coarse trace steps up and down a column of cells far more often than it
+// crosses into the next one, so the prefabs reaching into the last column
+// (xz min and max) are kept as one [min, max) range in y. Only a new column
+// looks up its squares, at most four at the far level.
+ivec4 structureColumn = ivec4(0x7FFFFFFF);
+ivec2 structureColumnY = ivec2(0);
+
+// Whether any prefab reaches into the box [cellMin, cellMax), for the coarse
+// levels: a structure's bounds count as occupied, so empty space around it is
+// still skipped and only rays that enter a footprint go down to voxels.
+bool structureOverlaps(ivec3 cellMin, ivec3 cellMax) {
+    if (structureDensity() <= 0.0 || cellMin.y > STRUCTURE_TOP) return false;
+    ivec4 column = ivec4(cellMin.xz, cellMax.xz);
+    if (column != structureColumn) {
+        structureColumn = column;
+        structureColumnY = ivec2(0x7FFFFFFF, -0x7FFFFFFF);
+        ivec2 first = cellMin.xz >> STRUCTURE_GRID_SHIFT;
+        ivec2 last = (cellMax.xz - 1) >> STRUCTURE_GRID_SHIFT;
+        for (int z = first.y; z <= last.y; ++z) {
+            for (int x = first.x; x <= last.x; ++x) {
+                StructureInstance s = structureAt(ivec2(x, z));
+                if (s.model < 0) continue;
+                if (all(lessThan(cellMin.xz, s.origin.xz + s.extent.xz)) && all(greaterThan(cellMax.xz, s.origin.xz))) {
+                    structureColumnY.x = min(structureColumnY.x, s.origin.y);
+                    structureColumnY.y = max(structureColumnY.y, s.origin.y + s.extent.y);
+                }
+            }
+        }
+    }
+    return cellMin.y < structureColumnY.y && cellMax.y > structureColumnY.x;
+}
+
+#endif
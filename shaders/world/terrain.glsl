@@ -0,0 +1,74 @@
+#ifndef TOHA_TERRAIN_GLSL
+#define TOHA_TERRAIN_GLSL
+
+const float TERRAIN_AMP = 50.0;
+const float TERRAIN_BASE = 20.0;
+
+float hash11(float p) {
+    p = fract(p * 0.1031);
+    p *= p + 33.33;
+    p *= p + p;
+    return fract(p);
+}
+
+float simplex3(vec3 v) {
+    const vec2 C = vec2(1.0 / 6.0, 1.0 / 3.0);
+    const vec4 D = vec4(0.0, 0.5, 1.0, 2.0);
+    vec3 i = floor(v + dot(v, C.yyy));
+    vec3 x0 = v - i + dot(i, C.xxx);
+    vec3 g = step(x0.yzx, x0.xyz);
+    vec3 l = 1.0 - g;
+    vec3 i1 = min(g, l.zxy);
+    vec3 i2 = max(g, l.zxy);
+    vec3 x1 = x0 - i1 + C.xxx;
+    vec3 x2 = x0 - i2 + C.yyy;
+    vec3 x3 = x0 - D.yyy;
+    i = mod(i, 289.0);
+    vec4 p = mod((vec4(i.z) + vec4(0.0, i1.z, i2.z, 1.0)) * 34.0 + 1.0, 289.0);
+    p = mod((p + vec4(i.y) + vec4(0.0, i1.y, i2.y, 1.0)) * 34.0 + 1.0, 289.0);
+    p = mod((p + vec4(i.x) + vec4(0.0, i1.x, i2.x, 1.0)) * 34.0 + 1.0, 289.0);
+    vec4 j = p - 289.0 * floor(p / 289.0);
+    float inv7 = 1.0 / 7.0;
+    vec4 x_ = floor(j * inv7);
+    vec4 y_ = floor(j - 7.0 * x_);
+    vec4 x = x_ * C.x + C.yyyy;
+    vec4 y = y_ * C.x + C.yyyy;
+    vec4 h = 1.0 - abs(x) - abs(y);
+    vec4 b0 = vec4(x.xy, y.xy);
+    vec4 b1 = vec4(x.zw, y.zw);
+    vec4 s0 = floor(b0) * 2.0 + 1.0;
+    vec4 s1 = floor(b1) * 2.0 + 1.0;
+    vec4 sh = -step(h, vec4(0.0));
+    vec4 a0 = b0.xzyw + s0.xzyw * sh.xxyy;
+    vec4 a1 = b1.xzyw + s1.xzyw * sh.zzww;
+    vec3 g0 = vec3(a0.xy, h.x);
+    vec3 g1 = vec3(a0.zw, h.y);
+    vec3 g2 = vec3(a1.xy, h.z);
+    vec3 g3 = vec3(a1.zw, h.w);
+    vec4 norm = inversesqrt(vec4(dot(g0, g0), dot(g1, g1), dot(g2, g2), dot(g3, g3)));
+    g0 *= norm.x;
+    g1 *= norm.y;
+    g2 *= norm.z;
+    g3 *= norm.w;
+    vec4 m = max(0.6 - vec4(dot(x0, x0), dot(x1, x1), dot(x2, x2), dot(x3, x3)), 0.0);
+    m = m * m;
+    return 42.0 * dot(m * m, vec4(dot(g0, x0), dot(g1, x1), dot(g2, x2), dot(g3, x3)));
+}
+
+float fbm2D(vec2 p, int octaves) {
+    float value = 0.0;
+    float amp = 0.5;
+    float freq = 1.0;
+    for (int i = 0; i < octaves; i++) {
+        value += amp * simplex3(vec3(p.x * freq, 0.0, p.y * freq));
+        freq *= 2.0;
+        amp *= 0.5;
+    }
+    return value;
+}
+
+float terrainHeight(vec2 p) {
+    return fbm2D(p * 0.01, 5) * TERRAIN_AMP + TERRAIN_BASE;
+}
+
+#endif
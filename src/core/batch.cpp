@@ -0,0 +1,145 @@
+#include "core/batch.hpp"
+
+#include "core/camera_list.hpp"
+#include "core/logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+// Shards are whole processes rather than threads: every shard gets its own
+// instance and device, which is what lets several software rasterizer
+// processes (lavapipe) or several GPUs work side by side. Shard i renders
+// cameras i, i + n, i + 2n, ... so all shards finish at about the same time.
+// Timings include each process's startup; that is what a batch costs.
+
+struct ShardRun {
+    uint32_t shards{};
+    double seconds{};
+    double imagesPerSecond{};
+};
+
+// A POSIX shell still expands $, ` and \ inside double quotes, so there each
+// argument goes in single quotes, with ' written as '\''.
+static std::string quoteArgument(const std::string& arg) {
+#ifdef _WIN32
+    std::string quoted = "\"";
+    for (char c : arg) {
+        if (c == '"') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+#else
+    std::string quoted = "'";
+    for (char c : arg) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+#endif
+}
+
+// Each lavapipe process would otherwise start a thread per core, so n shards
+// would oversubscribe the machine n times over. An explicit setting wins.
+static void setRasterizerThreads(uint32_t threads) {
+    std::string value = std::to_string(threads);
+#ifdef _WIN32
+    _putenv_s("LP_NUM_THREADS", value.c_str());
+#else
+    setenv("LP_NUM_THREADS", value.c_str(), 1);
+#endif
+}
+
+static bool runShards(const std::string& executable, const std::vector<std::string>& args, uint32_t shards, double& seconds) {
+    std::string command = quoteArgument(executable);
+    for (const auto& arg : args) command += " " + quoteArgument(arg);
+#ifdef _WIN32
+    // cmd.exe drops the first and last quote of the whole line.
+    command = "\"" + command;
+#endif
+
+    std::vector<int> results(shards, 0);
+    std::vector<std::thread> workers;
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < shards; i++) {
+        std::string shardCommand = command + " --shard " + std::to_string(i) + "/" + std::to_string(shards);
+#ifdef _WIN32
+        shardCommand += "\"";
+#endif
+        workers.emplace_back([&results, i, shardCommand] { results[i] = std::system(shardCommand.c_str()); });
+    }
+    for (auto& worker : workers) worker.join();
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    bool ok = true;
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    for (uint32_t i = 0; i < shards; i++) {
+        if (results[i] == 0) continue;
+        ok = false;
+        if (gLogFile.is_open()) gLogFile << "batch: shard " << i << "/" << shards << " failed with " << results[i] << '\n';
+    }
+    return ok;
+}
+
+int runBatchShards(const std::string& executable, const std::vector<std::string>& args, const AppOptions& options) {
+    std::vector<CameraPose> poses;
+    if (!loadCameraList(options.batchCameras, poses)) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) gLogFile << "batch: failed to read camera list " << options.batchCameras << '\n';
+        return 1;
+    }
+
+    uint32_t maxShards = std::max(options.batchShards, 1u);
+    std::vector<uint32_t> counts;
+    if (options.batchScaling) {
+        for (uint32_t n = 1; n < maxShards; n *= 2) counts.push_back(n);
+    }
+    counts.push_back(maxShards);
+
+    uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool threadsSet = std::getenv("LP_NUM_THREADS") != nullptr;
+
+    std::vector<ShardRun> runs;
+    for (uint32_t shards : counts) {
+        if (!threadsSet) setRasterizerThreads(std::max(hardwareThreads / shards, 1u));
+        ShardRun run;
+        run.shards = shards;
+        if (!runShards(executable, args, shards, run.seconds)) return 1;
+        run.imagesPerSecond = static_cast<double>(poses.size()) / run.seconds;
+        runs.push_back(run);
+
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) {
+            char line[192];
+            std::snprintf(line, sizeof(line), "batch: %u shards, %zu images in %.2f s, %.2f images/s (%.2f per shard), %.2fx\n",
+                          shards, poses.size(), run.seconds, run.imagesPerSecond, run.imagesPerSecond / shards,
+                          run.imagesPerSecond / runs.front().imagesPerSecond);
+            gLogFile << line;
+            gLogFile.flush();
+        }
+    }
+
+    // Speedup is against the first run, which is a single shard when scaling.
+    std::ofstream out(options.batchReport, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) return 0;
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "{\n  \"images\": %zu,\n  \"resolution\": [%u, %u],\n  \"samples\": %u,\n  \"hardware_threads\": %u,\n",
+                  poses.size(), options.batchWidth, options.batchHeight, options.batchSamples, hardwareThreads);
+    out << buf;
+    out << "  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); i++) {
+        double speedup = runs[i].imagesPerSecond / runs.front().imagesPerSecond;
+        double relativeShards = static_cast<double>(runs[i].shards) / runs.front().shards;
+        std::snprintf(buf, sizeof(buf),
+                      "%s\n    { \"shards\": %u, \"seconds\": %.3f, \"images_per_s\": %.3f, \"images_per_s_per_shard\": %.3f, "
+                      "\"speedup\": %.3f, \"efficiency\": %.3f }",
+                      i ? "," : "", runs[i].shards, runs[i].seconds, runs[i].imagesPerSecond,
+                      runs[i].imagesPerSecond / runs[i].shards, speedup, speedup / relativeShards);
+        out << buf;
+    }
+    out << "\n  ]\n}\n";
+    return 0;
+}
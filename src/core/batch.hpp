@@ -0,0 +1,11 @@
+#pragma once
+
+#include "core/options.hpp"
+
+#include <string>
+#include <vector>
+
+// Runs a batch render as options.batchShards copies of `executable`, each
+// started with `args` plus "--shard <i>/<n>", and writes the throughput of
+// every run to options.batchReport. Returns the process exit code.
+int runBatchShards(const std::string& executable, const std::vector<std::string>& args, const AppOptions& options);
@@ -0,0 +1,20 @@
+#include "core/camera_list.hpp"
+
+#include <fstream>
+#include <sstream>
+
+bool loadCameraList(const std::string& path, std::vector<CameraPose>& poses) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        std::istringstream fields(line);
+        CameraPose pose;
+        if (!(fields >> pose.x >> pose.y >> pose.z >> pose.yaw >> pose.pitch)) return false;
+        poses.push_back(pose);
+    }
+    return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A camera in the fly camera's terms: position plus yaw and pitch in radians.
+struct CameraPose {
+    float x{};
+    float y{};
+    float z{};
+    float yaw{};
+    float pitch{};
+};
+
+// One camera per line, "x y z yaw pitch"; blank lines and lines starting with
+// '#' are skipped. Returns false if the file cannot be read or a line does not
+// parse.
+bool loadCameraList(const std::string& path, std::vector<CameraPose>& poses);
@@ -0,0 +1,36 @@
+#include "core/input_recording.hpp"
+
+#include <cstring>
+
+static const char INPUT_RECORDING_MAGIC[8] = { 'V', 'X', 'I', 'N', 'P', 'U', 'T', '1' };
+
+bool InputRecorder::start(const std::string& path, const CameraPose& start) {
+    stop();
+    out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    out.write(INPUT_RECORDING_MAGIC, sizeof(INPUT_RECORDING_MAGIC));
+    out.write(reinterpret_cast<const char*>(&start), sizeof(start));
+    return out.good();
+}
+
+void InputRecorder::write(const InputSample& sample) {
+    if (!out.is_open()) return;
+    out.write(reinterpret_cast<const char*>(&sample), sizeof(sample));
+}
+
+void InputRecorder::stop() {
+    if (out.is_open()) out.close();
+}
+
+bool loadInputRecording(const std::string& path, CameraPose& start, std::vector<InputSample>& samples) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) return false;
+
+    char magic[sizeof(INPUT_RECORDING_MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, INPUT_RECORDING_MAGIC, sizeof(magic)) != 0) return false;
+    if (!in.read(reinterpret_cast<char*>(&start), sizeof(start))) return false;
+
+    InputSample sample;
+    while (in.read(reinterpret_cast<char*>(&sample), sizeof(sample))) samples.push_back(sample);
+    return true;
+}
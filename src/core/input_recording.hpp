@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/camera_list.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Held keys of the fly camera, as bits of InputSample::keys.
+enum InputKey : uint16_t {
+    INPUT_FORWARD = 1 << 0,
+    INPUT_BACK = 1 << 1,
+    INPUT_LEFT = 1 << 2,
+    INPUT_RIGHT = 1 << 3,
+    INPUT_UP = 1 << 4,
+    INPUT_DOWN = 1 << 5,
+    INPUT_FAST = 1 << 6,
+};
+
+// One poll of the fly camera's input: the time step it moves the camera
+// over, the mouse movement in pixels and the held keys. `frames` counts the
+// frames the renderer finished since the previous sample, that is with the
+// camera as it was before this one.
+struct InputSample {
+    float dt{};
+    float mouseDx{};
+    float mouseDy{};
+    uint16_t keys{};
+    uint16_t frames{};
+};
+
+static_assert(sizeof(InputSample) == 16, "InputSample is written to disk as is");
+
+// A recording is "VXINPUT1", the camera pose it starts from, then one
+// InputSample per input poll, in the byte order of the machine that wrote it.
+class InputRecorder {
+public:
+    ~InputRecorder() { stop(); }
+
+    bool start(const std::string& path, const CameraPose& start);
+    void write(const InputSample& sample);
+    void stop();
+    bool active() const { return out.is_open(); }
+
+private:
+    std::ofstream out;
+};
+
+// Returns false if the file cannot be read or is not a recording; a sample
+// cut off at the end is dropped.
+bool loadInputRecording(const std::string& path, CameraPose& start, std::vector<InputSample>& samples);
@@ -0,0 +1,164 @@
+#include "core/metrics.hpp"
+
+#include "core/net.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+MetricsRegistry gMetrics;
+
+static void appendHeader(std::string& out, const Metric& metric, const char* type) {
+    out += "# HELP " + metric.name + " " + metric.help + "\n";
+    out += "# TYPE " + metric.name + " " + type + "\n";
+}
+
+static void appendValue(std::string& out, const std::string& name, double value) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), " %.17g\n", value);
+    out += name;
+    out += buf;
+}
+
+void MetricCounter::write(std::string& out) const {
+    appendHeader(out, *this, "counter");
+    appendValue(out, name, static_cast<double>(value.load(std::memory_order_relaxed)));
+}
+
+void MetricGauge::write(std::string& out) const {
+    appendHeader(out, *this, "gauge");
+    appendValue(out, name, value.load(std::memory_order_relaxed));
+}
+
+MetricHistogram::MetricHistogram(std::string metricName, std::string metricHelp, std::vector<double> upperBounds)
+    : Metric(std::move(metricName), std::move(metricHelp)),
+      bounds(std::move(upperBounds)),
+      buckets(new std::atomic<uint64_t>[bounds.size() + 1]) {
+    for (size_t i = 0; i <= bounds.size(); i++) buckets[i].store(0, std::memory_order_relaxed);
+}
+
+void MetricHistogram::observe(double v) {
+    size_t i = 0;
+    while (i < bounds.size() && v > bounds[i]) i++;
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    double current = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(current, current + v, std::memory_order_relaxed)) {}
+}
+
+// Buckets are cumulative in the exposition format. A scrape racing an
+// observe may see the bucket before the count; Prometheus tolerates that.
+void MetricHistogram::write(std::string& out) const {
+    appendHeader(out, *this, "histogram");
+    char label[64];
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= bounds.size(); i++) {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        if (i < bounds.size()) std::snprintf(label, sizeof(label), "_bucket{le=\"%g\"}", bounds[i]);
+        else std::snprintf(label, sizeof(label), "_bucket{le=\"+Inf\"}");
+        appendValue(out, name + label, static_cast<double>(cumulative));
+    }
+    appendValue(out, name + "_sum", sum.load(std::memory_order_relaxed));
+    appendValue(out, name + "_count", static_cast<double>(count.load(std::memory_order_relaxed)));
+}
+
+Metric* MetricsRegistry::find(const std::string& name) const {
+    for (const auto& metric : metrics) {
+        if (metric->name == name) return metric.get();
+    }
+    return nullptr;
+}
+
+MetricCounter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto* existing = dynamic_cast<MetricCounter*>(find(name))) return *existing;
+    metrics.push_back(std::make_unique<MetricCounter>(name, help));
+    return static_cast<MetricCounter&>(*metrics.back());
+}
+
+MetricGauge& MetricsRegistry::gauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto* existing = dynamic_cast<MetricGauge*>(find(name))) return *existing;
+    metrics.push_back(std::make_unique<MetricGauge>(name, help));
+    return static_cast<MetricGauge&>(*metrics.back());
+}
+
+MetricHistogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto* existing = dynamic_cast<MetricHistogram*>(find(name))) return *existing;
+    metrics.push_back(std::make_unique<MetricHistogram>(name, help, bounds));
+    return static_cast<MetricHistogram&>(*metrics.back());
+}
+
+std::string MetricsRegistry::exposition() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string out;
+    for (const auto& metric : metrics) metric->write(out);
+    return out;
+}
+
+bool MetricsServer::start(uint16_t port) {
+    if (!initSockets()) return false;
+    listenSocket = listenLoopback(port);
+    if (listenSocket < 0) {
+        cleanupSockets();
+        return false;
+    }
+    stopping = false;
+    worker = std::thread(&MetricsServer::run, this);
+    return true;
+}
+
+// Any GET is answered with the metrics, whatever the path; Prometheus sends
+// its whole request in one segment. One client is served at a time, so a
+// connection that sends nothing is dropped after CLIENT_TIMEOUT_SECONDS rather
+// than holding up every later scrape.
+void MetricsServer::run() {
+    for (;;) {
+        intptr_t client = acceptClient(listenSocket);
+        if (client < 0) {
+            if (stopping) return;
+            std::this_thread::sleep_for(std::chrono::duration<double>(ACCEPT_RETRY_SECONDS));
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(clientMutex);
+            if (stopping) {
+                closeSocket(client);
+                return;
+            }
+            clientSocket = client;
+        }
+        setSocketTimeout(client, CLIENT_TIMEOUT_SECONDS);
+        char request[1024];
+        long n = readSome(client, request, sizeof(request) - 1);
+        std::string response;
+        if (n >= 4 && std::memcmp(request, "GET ", 4) == 0) {
+            std::string body = gMetrics.exposition();
+            response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                       std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        } else {
+            response = "HTTP/1.0 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        }
+        writeAll(client, response.data(), response.size());
+        {
+            std::lock_guard<std::mutex> lock(clientMutex);
+            clientSocket = -1;
+        }
+        closeSocket(client);
+    }
+}
+
+void MetricsServer::stop() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(clientMutex);
+        stopping = true;
+        shutdownSocket(clientSocket);
+    }
+    shutdownSocket(listenSocket);
+    worker.join();
+    closeSocket(listenSocket);
+    listenSocket = -1;
+    cleanupSockets();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Process-wide metrics in Prometheus terms. Registration takes a lock and is
+// meant for startup; the returned metric lives as long as the process, and
+// updating it is a couple of relaxed atomic operations, cheap enough for
+// every frame.
+
+class Metric {
+public:
+    Metric(std::string metricName, std::string metricHelp) : name(std::move(metricName)), help(std::move(metricHelp)) {}
+    virtual ~Metric() = default;
+    virtual void write(std::string& out) const = 0;
+
+    const std::string name;
+    const std::string help;
+};
+
+class MetricCounter : public Metric {
+public:
+    using Metric::Metric;
+    void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    void write(std::string& out) const override;
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+class MetricGauge : public Metric {
+public:
+    using Metric::Metric;
+    void set(double v) { value.store(v, std::memory_order_relaxed); }
+    void write(std::string& out) const override;
+
+private:
+    std::atomic<double> value{0.0};
+};
+
+// Fixed upper bounds, ascending; quantiles come from histogram_quantile on
+// the scraping side.
+class MetricHistogram : public Metric {
+public:
+    MetricHistogram(std::string metricName, std::string metricHelp, std::vector<double> upperBounds);
+    void observe(double v);
+    void write(std::string& out) const override;
+
+private:
+    const std::vector<double> bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets; // bounds.size() + 1, the last is +Inf
+    std::atomic<uint64_t> count{0};
+    std::atomic<double> sum{0.0};
+};
+
+class MetricsRegistry {
+public:
+    // Returns the metric already registered under `name` if there is one.
+    MetricCounter& counter(const std::string& name, const std::string& help);
+    MetricGauge& gauge(const std::string& name, const std::string& help);
+    MetricHistogram& histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds);
+
+    // Text exposition format 0.0.4.
+    std::string exposition() const;
+
+private:
+    Metric* find(const std::string& name) const;
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Metric>> metrics;
+};
+
+extern MetricsRegistry gMetrics;
+
+// Serves gMetrics over HTTP on a loopback port, one short connection per
+// scrape, from its own thread.
+class MetricsServer {
+public:
+    ~MetricsServer() { stop(); }
+
+    bool start(uint16_t port);
+    void stop();
+
+private:
+    const double ACCEPT_RETRY_SECONDS = 0.01;
+    const double CLIENT_TIMEOUT_SECONDS = 2.0;
+
+    void run();
+
+    intptr_t listenSocket = -1;
+    // The connection being answered, so stop() can wake the worker there too.
+    intptr_t clientSocket = -1;
+    std::mutex clientMutex;
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+};
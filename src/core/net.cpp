@@ -0,0 +1,144 @@
+#include "core/net.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+using NativeSocket = SOCKET;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+using NativeSocket = int;
+#endif
+
+static NativeSocket nativeSocket(intptr_t s) {
+    return static_cast<NativeSocket>(s);
+}
+
+static intptr_t bindAndListen(intptr_t s, const sockaddr* address, size_t size) {
+    if (s < 0) return -1;
+    if (bind(nativeSocket(s), address, static_cast<int>(size)) != 0 || listen(nativeSocket(s), SOMAXCONN) != 0) {
+        closeSocket(s);
+        return -1;
+    }
+    return s;
+}
+
+bool initSockets() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+    return true;
+#endif
+}
+
+void cleanupSockets() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+intptr_t listenUnix(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    // A socket file left behind by a previous run would make bind fail.
+    std::remove(path.c_str());
+
+    intptr_t s = static_cast<intptr_t>(socket(AF_UNIX, SOCK_STREAM, 0));
+    return bindAndListen(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+intptr_t listenLoopback(uint16_t port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    intptr_t s = static_cast<intptr_t>(socket(AF_INET, SOCK_STREAM, 0));
+    if (s >= 0) {
+        // A restarted node must be able to take its port back right away.
+        int reuse = 1;
+        setsockopt(nativeSocket(s), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    }
+    return bindAndListen(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+intptr_t acceptClient(intptr_t listenSocket) {
+    return static_cast<intptr_t>(accept(nativeSocket(listenSocket), nullptr, nullptr));
+}
+
+void closeSocket(intptr_t s) {
+    if (s < 0) return;
+#ifdef _WIN32
+    closesocket(nativeSocket(s));
+#else
+    close(nativeSocket(s));
+#endif
+}
+
+void shutdownSocket(intptr_t s) {
+    if (s < 0) return;
+#ifdef _WIN32
+    shutdown(nativeSocket(s), SD_BOTH);
+#else
+    shutdown(nativeSocket(s), SHUT_RDWR);
+#endif
+}
+
+void setSocketTimeout(intptr_t s, double seconds) {
+    if (s < 0) return;
+#ifdef _WIN32
+    DWORD timeout = static_cast<DWORD>(seconds * 1000.0);
+#else
+    timeval timeout{};
+    timeout.tv_sec = static_cast<time_t>(seconds);
+    timeout.tv_usec = static_cast<suseconds_t>((seconds - static_cast<double>(timeout.tv_sec)) * 1e6);
+#endif
+    const char* value = reinterpret_cast<const char*>(&timeout);
+    setsockopt(nativeSocket(s), SOL_SOCKET, SO_RCVTIMEO, value, sizeof(timeout));
+    setsockopt(nativeSocket(s), SOL_SOCKET, SO_SNDTIMEO, value, sizeof(timeout));
+}
+
+long readSome(intptr_t s, void* data, size_t size) {
+    int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+    return static_cast<long>(recv(nativeSocket(s), static_cast<char*>(data), chunk, 0));
+}
+
+bool readAll(intptr_t s, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        long n = readSome(s, p, size);
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeAll(intptr_t s, const void* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL; // a client hanging up must not kill the process
+#else
+    const int flags = 0;
+#endif
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+        auto n = send(nativeSocket(s), p, chunk, flags);
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
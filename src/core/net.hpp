@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Thin blocking socket helpers shared by the render server and the metrics
+// endpoint. Sockets are passed around as intptr_t; an invalid socket is
+// negative on every platform (INVALID_SOCKET is ~0).
+
+// WSAStartup/WSACleanup on Windows, nothing elsewhere. Calls nest.
+bool initSockets();
+void cleanupSockets();
+
+// Both return -1 on failure.
+intptr_t listenUnix(const std::string& path);
+intptr_t listenLoopback(uint16_t port);
+intptr_t acceptClient(intptr_t listenSocket);
+
+void closeSocket(intptr_t s);
+// Unblocks a thread sitting in recv or accept on the socket.
+void shutdownSocket(intptr_t s);
+// Makes recv and send on the socket fail after `seconds` without progress.
+void setSocketTimeout(intptr_t s, double seconds);
+bool readAll(intptr_t s, void* data, size_t size);
+bool writeAll(intptr_t s, const void* data, size_t size);
+// Whatever one recv returns; 0 when the peer closed, negative on error.
+long readSome(intptr_t s, void* data, size_t size);
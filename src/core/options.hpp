@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct AppOptions {
+    bool enableValidation = false;
+    bool benchmark = false;
+    double benchmarkSeconds = 10.0;
+    std::string benchmarkOutput = "benchmark.json";
+    // Non-empty times the raymarch building blocks (bench_kernels.comp)
+    // headless and writes evaluations per second to this file.
+    std::string kernelBenchOutput;
+    // Non-empty counts the raymarch's traversal steps per ray and writes the
+    // totals and GPU times to this file on exit.
+    std::string renderStatsOutput;
+    // Non-empty measures shader clock cycles per raymarch invocation (needs
+    // VK_KHR_shader_clock) and writes the mean cost per pixel as
+    // <costHeatmapOutput>.png and per-tile totals as <costHeatmapOutput>.json
+    // on exit. costOverlay also tints the rendered image with the heatmap.
+    std::string costHeatmapOutput;
+    bool costOverlay = false;
+    // Non-empty records CPU zones and GPU passes and writes them to this file
+    // as a Chrome trace on exit.
+    std::string traceOutput;
+    // A frame longer than hitchThresholdMs dumps the last few seconds of
+    // per-frame timings to <hitchOutput>_<frame>.json; 0 (the default) disables.
+    double hitchThresholdMs = 0.0;
+    std::string hitchOutput = "hitch";
+    // Non-empty records the camera's input and frame counts to this file.
+    // replayInput plays such a recording back through the same camera update,
+    // paced by the recorded time steps or replayDt seconds per sample, in the
+    // window or, with replayHeadless, offscreen as fast as the GPU allows.
+    // trajectoryOutput lists the camera pose after every sample, one camera
+    // list line each.
+    std::string recordInput;
+    std::string replayInput;
+    bool replayHeadless = false;
+    double replayDt = 0.0;
+    std::string trajectoryOutput;
+    // Non-zero serves Prometheus metrics on 127.0.0.1 at this port.
+    uint32_t metricsPort = 0;
+    // Non-empty writes register usage, statistics and the driver's internal
+    // representations of every pipeline to this file.
+    std::string pipelineReport;
+    // Share of the device-local heap budget the engine's caches may fill.
+    double memoryBudgetFraction = 0.8;
+    // fifo, fifo-relaxed, mailbox or immediate; falls back to fifo.
+    std::string presentMode = "mailbox";
+    // Frames per second, 0 = unlimited. Input is sampled after the limiter sleeps.
+    double frameLimit = 0.0;
+    // Empty disables capture. For png this is the file name prefix.
+    std::string captureOutput;
+    std::string captureFormat = "y4m";
+    // Accumulate full-resolution samples while the camera is still, then stop
+    // rendering until it moves.
+    bool idleRefinement = true;
+    // Extrapolate the camera to the frame's expected display time.
+    bool cameraPrediction = true;
+    // off, jitter, interleaved (a quarter of the pixels traced per frame) or
+    // interleaved16 (a sixteenth).
+    std::string temporalMode = "interleaved";
+    // Terrain beyond nearDistance comes from a cached far layer that retraces
+    // up to farUpdateFraction of its texels per frame. farDistance 0 disables
+    // the split and the near trace alone runs to 1 km.
+    double nearDistance = 256.0;
+    double farDistance = 50000.0;
+    double farUpdateFraction = 0.1;
+    // Grass voxels closer than this many metres get 4x4x4 sub-voxel detail;
+    // 0 keeps them solid.
+    double microDistance = 0.0;
+    // Chance that a 64 m square of terrain holds a prefab structure; 0 (the
+    // default) turns them off.
+    double structureDensity = 0.0;
+    // single, mirror (rear-view inset), minimap (top-down inset) or quad (four
+    // directions in a 2x2 grid, like a probe); all views render in one dispatch.
+    std::string viewLayout = "single";
+    // Non-empty renders one still of screenshotWidth x screenshotHeight to
+    // this PNG without opening a window, screenshotTile pixels square at a
+    // time, each refined over screenshotSamples samples.
+    std::string screenshotOutput;
+    uint32_t screenshotWidth = 16384;
+    uint32_t screenshotHeight = 9216;
+    uint32_t screenshotTile = 1024;
+    uint32_t screenshotSamples = 16;
+    // Non-empty renders every camera of this list (see camera_list.hpp)
+    // headless to <batchOutput>_<index>.png. With batchShards > 1 the list is
+    // split over that many processes, each on the next suitable device;
+    // batchScaling repeats the run with 1, 2, 4, ... shards and reports the
+    // speedup. shardIndex is set on the processes doing the work.
+    std::string batchCameras;
+    std::string batchOutput = "frame";
+    std::string batchReport = "batch_report.json";
+    uint32_t batchWidth = 1280;
+    uint32_t batchHeight = 720;
+    uint32_t batchSamples = 8;
+    uint32_t batchShards = 1;
+    bool batchScaling = false;
+    int32_t shardIndex = -1;
+    // Non-empty runs headless as a render server on this Unix domain socket
+    // (protocol in render_server.hpp). Requests up to serveWidth x
+    // serveHeight are taken; several small ones share a dispatch.
+    std::string serveSocket;
+    uint32_t serveWidth = 1920;
+    uint32_t serveHeight = 1080;
+};
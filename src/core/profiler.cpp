@@ -0,0 +1,119 @@
+#include "core/profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Every thread appends to its own buffer; the buffer's mutex is only ever
+// contended while a trace is being written. Buffers are never freed, so a
+// thread that has exited still shows up in the trace.
+
+struct ProfileRecord {
+    const char* name{};
+    uint64_t begin{};
+    uint64_t end{};
+};
+
+struct ThreadTrace {
+    uint32_t id{};
+    bool gpu{};
+    std::string name;
+    std::mutex mutex;
+    std::vector<ProfileRecord> events;
+};
+
+std::atomic<bool> gProfilerEnabled{false};
+
+static std::mutex gTracesMutex;
+static std::vector<std::unique_ptr<ThreadTrace>> gTraces;
+// About 24 MB per thread; later events are dropped.
+static const size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+static ThreadTrace& addTrace(const std::string& name, bool gpu) {
+    std::lock_guard<std::mutex> lock(gTracesMutex);
+    gTraces.push_back(std::make_unique<ThreadTrace>());
+    ThreadTrace& trace = *gTraces.back();
+    trace.id = static_cast<uint32_t>(gTraces.size());
+    trace.gpu = gpu;
+    trace.name = name.empty() ? "thread " + std::to_string(trace.id) : name;
+    return trace;
+}
+
+static ThreadTrace& threadTrace() {
+    thread_local ThreadTrace* trace = nullptr;
+    if (!trace) trace = &addTrace("", false);
+    return *trace;
+}
+
+static void append(ThreadTrace& trace, const char* name, uint64_t beginNs, uint64_t endNs) {
+    std::lock_guard<std::mutex> lock(trace.mutex);
+    if (trace.events.size() < MAX_EVENTS_PER_THREAD) trace.events.push_back({ name, beginNs, endNs });
+}
+
+uint64_t profilerNow() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void profileEvent(const char* name, uint64_t beginNs, uint64_t endNs) {
+    append(threadTrace(), name, beginNs, endNs);
+}
+
+void profileGpuEvent(const char* track, const char* name, uint64_t beginNs, uint64_t endNs) {
+    if (!gProfilerEnabled.load(std::memory_order_relaxed)) return;
+    ThreadTrace* trace = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(gTracesMutex);
+        for (auto& t : gTraces) {
+            if (t->gpu && t->name == track) trace = t.get();
+        }
+    }
+    if (!trace) trace = &addTrace(track, true);
+    append(*trace, name, beginNs, endNs);
+}
+
+void setProfilerThreadName(const std::string& name) {
+    ThreadTrace& trace = threadTrace();
+    std::lock_guard<std::mutex> lock(gTracesMutex);
+    trace.name = name;
+}
+
+// CPU threads are process 1 and GPU queues process 2, so the two groups stay
+// apart in the viewer. Timestamps are microseconds from the first event.
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    std::lock_guard<std::mutex> lock(gTracesMutex);
+    uint64_t origin = UINT64_MAX;
+    for (auto& trace : gTraces) {
+        std::lock_guard<std::mutex> traceLock(trace->mutex);
+        for (const auto& e : trace->events) origin = std::min(origin, e.begin);
+    }
+    if (origin == UINT64_MAX) origin = 0;
+
+    char buf[256];
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}";
+    for (auto& trace : gTraces) {
+        std::lock_guard<std::mutex> traceLock(trace->mutex);
+        int pid = trace->gpu ? 2 : 1;
+        std::snprintf(buf, sizeof(buf), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                      pid, trace->id, trace->name.c_str());
+        out << buf;
+        for (const auto& e : trace->events) {
+            uint64_t end = std::max(e.end, e.begin);
+            std::snprintf(buf, sizeof(buf), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                          e.name, pid, trace->id, static_cast<double>(e.begin - origin) / 1000.0,
+                          static_cast<double>(end - e.begin) / 1000.0);
+            out << buf;
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return out.good();
+}
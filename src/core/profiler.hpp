@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped CPU zones recorded into per-thread buffers, plus GPU ranges already
+// converted to the same clock, exported as a Chrome trace that both
+// chrome://tracing and the Perfetto UI open. Times are steady_clock
+// nanoseconds, which is the host clock Vulkan calibrated timestamps report
+// (CLOCK_MONOTONIC, or the performance counter on Windows). Zone names must
+// outlive the export; string literals do.
+
+extern std::atomic<bool> gProfilerEnabled;
+
+uint64_t profilerNow();
+void profileEvent(const char* name, uint64_t beginNs, uint64_t endNs);
+// GPU ranges go to one track per queue, named `track`.
+void profileGpuEvent(const char* track, const char* name, uint64_t beginNs, uint64_t endNs);
+void setProfilerThreadName(const std::string& name);
+bool writeChromeTrace(const std::string& path);
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* zoneName)
+        : name(zoneName), begin(gProfilerEnabled.load(std::memory_order_relaxed) ? profilerNow() : 0) {}
+    ~ProfileZone() {
+        if (begin) profileEvent(name, begin, profilerNow());
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t begin;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer handoff of the latest value. The
+// producer never waits for the consumer; values the consumer did not pick up
+// in time are overwritten, which is what we want for per-frame state.
+template <typename T>
+class TripleBuffer {
+public:
+    void write(const T& value) {
+        slots[back] = value;
+        uint32_t previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = previous & INDEX_MASK;
+    }
+
+    // Sets `out` to the newest value written so far and returns whether it
+    // changed since the last read.
+    bool read(T& out) {
+        bool fresh = (middle.load(std::memory_order_acquire) & FRESH) != 0;
+        if (fresh) {
+            uint32_t previous = middle.exchange(front, std::memory_order_acq_rel);
+            front = previous & INDEX_MASK;
+        }
+        out = slots[front];
+        return fresh;
+    }
+
+private:
+    static constexpr uint32_t INDEX_MASK = 3;
+    static constexpr uint32_t FRESH = 4;
+
+    T slots[3]{};
+    std::atomic<uint32_t> middle{1};
+    uint32_t back = 0;  // producer only
+    uint32_t front = 2; // consumer only
+};
@@ -4,34 +4,130 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <cstdlib>
+#include <cstdio>
 
 #include "core/logging.hpp"
+#include "core/options.hpp"
+#include "core/batch.hpp"
 #include "render/vulkan/vulkan_app.hpp"
 
 int main(int argc, char** argv) {
+    AppOptions options;
 #ifndef NDEBUG
-    bool enableDebug = true;
-#else
-    bool enableDebug = false;
+    options.enableValidation = true;
 #endif
 
-    gLogFile.open("voxel_engine.log", std::ios::out | std::ios::trunc);
+    if (std::getenv("VOXEL_VK_DEBUG")) {
+        options.enableValidation = true;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--vk-debug") options.enableValidation = true;
+        if (arg == "--vk-nodebug") options.enableValidation = false;
+        if (arg == "--benchmark") options.benchmark = true;
+        if (arg == "--benchmark-seconds" && hasValue) options.benchmarkSeconds = std::atof(argv[++i]);
+        if (arg == "--benchmark-out" && hasValue) options.benchmarkOutput = argv[++i];
+        if (arg == "--bench-kernels" && hasValue) options.kernelBenchOutput = argv[++i];
+        if (arg == "--render-stats" && hasValue) options.renderStatsOutput = argv[++i];
+        if (arg == "--cost-heatmap" && hasValue) options.costHeatmapOutput = argv[++i];
+        if (arg == "--cost-overlay") options.costOverlay = true;
+        if (arg == "--pipeline-report" && hasValue) options.pipelineReport = argv[++i];
+        if (arg == "--trace" && hasValue) options.traceOutput = argv[++i];
+        if (arg == "--hitch-ms" && hasValue) options.hitchThresholdMs = std::atof(argv[++i]);
+        if (arg == "--hitch-out" && hasValue) options.hitchOutput = argv[++i];
+        if (arg == "--record-input" && hasValue) options.recordInput = argv[++i];
+        if (arg == "--replay" && hasValue) options.replayInput = argv[++i];
+        if (arg == "--replay-headless") options.replayHeadless = true;
+        if (arg == "--replay-dt" && hasValue) options.replayDt = std::atof(argv[++i]);
+        if (arg == "--trajectory" && hasValue) options.trajectoryOutput = argv[++i];
+        if (arg == "--metrics-port" && hasValue) options.metricsPort = static_cast<uint32_t>(std::atoi(argv[++i]));
+        if (arg == "--memory-budget-fraction" && hasValue) options.memoryBudgetFraction = std::atof(argv[++i]);
+        if (arg == "--present-mode" && hasValue) options.presentMode = argv[++i];
+        if (arg == "--frame-limit" && hasValue) options.frameLimit = std::atof(argv[++i]);
+        if (arg == "--capture" && hasValue) options.captureOutput = argv[++i];
+        if (arg == "--capture-format" && hasValue) options.captureFormat = argv[++i];
+        if (arg == "--no-refine") options.idleRefinement = false;
+        if (arg == "--no-predict") options.cameraPrediction = false;
+        if (arg == "--taa" && hasValue) options.temporalMode = argv[++i];
+        if (arg == "--near-distance" && hasValue) options.nearDistance = std::atof(argv[++i]);
+        if (arg == "--far-distance" && hasValue) options.farDistance = std::atof(argv[++i]);
+        if (arg == "--far-update-fraction" && hasValue) options.farUpdateFraction = std::atof(argv[++i]);
+        if (arg == "--micro-distance" && hasValue) options.microDistance = std::atof(argv[++i]);
+        if (arg == "--structure-density" && hasValue) options.structureDensity = std::atof(argv[++i]);
+        if (arg == "--views" && hasValue) options.viewLayout = argv[++i];
+        if (arg == "--screenshot" && hasValue) options.screenshotOutput = argv[++i];
+        if (arg == "--screenshot-size" && hasValue) {
+            unsigned width = 0;
+            unsigned height = 0;
+            if (std::sscanf(argv[++i], "%ux%u", &width, &height) == 2) {
+                options.screenshotWidth = width;
+                options.screenshotHeight = height;
+            }
+        }
+        if (arg == "--screenshot-tile" && hasValue) options.screenshotTile = static_cast<uint32_t>(std::atoi(argv[++i]));
+        if (arg == "--screenshot-samples" && hasValue) options.screenshotSamples = static_cast<uint32_t>(std::atoi(argv[++i]));
+        if (arg == "--batch" && hasValue) options.batchCameras = argv[++i];
+        if (arg == "--batch-out" && hasValue) options.batchOutput = argv[++i];
+        if (arg == "--batch-report" && hasValue) options.batchReport = argv[++i];
+        if (arg == "--batch-size" && hasValue) {
+            unsigned width = 0;
+            unsigned height = 0;
+            if (std::sscanf(argv[++i], "%ux%u", &width, &height) == 2) {
+                options.batchWidth = width;
+                options.batchHeight = height;
+            }
+        }
+        if (arg == "--batch-samples" && hasValue) options.batchSamples = static_cast<uint32_t>(std::atoi(argv[++i]));
+        if (arg == "--shards" && hasValue) options.batchShards = static_cast<uint32_t>(std::atoi(argv[++i]));
+        if (arg == "--batch-scaling") options.batchScaling = true;
+        if (arg == "--serve" && hasValue) options.serveSocket = argv[++i];
+        if (arg == "--serve-size" && hasValue) {
+            unsigned width = 0;
+            unsigned height = 0;
+            if (std::sscanf(argv[++i], "%ux%u", &width, &height) == 2) {
+                options.serveWidth = width;
+                options.serveHeight = height;
+            }
+        }
+        if (arg == "--shard" && hasValue) {
+            int index = 0;
+            unsigned count = 0;
+            if (std::sscanf(argv[++i], "%d/%u", &index, &count) == 2) {
+                options.shardIndex = index;
+                options.batchShards = count;
+            }
+        }
+    }
+
+    // A zero size would only fail once the device and an empty offscreen
+    // image had been created.
+    const char* invalidSize = nullptr;
+    if (options.screenshotWidth == 0 || options.screenshotHeight == 0) invalidSize = "--screenshot-size";
+    if (options.screenshotTile == 0) invalidSize = "--screenshot-tile";
+    if (options.batchWidth == 0 || options.batchHeight == 0) invalidSize = "--batch-size";
+    if (options.serveWidth == 0 || options.serveHeight == 0) invalidSize = "--serve-size";
+    if (invalidSize) {
+        std::cerr << invalidSize << ": width, height and tile size must be greater than 0\n";
+        return 1;
+    }
+
+    // Batch shards run side by side, so each keeps its own log.
+    std::string logName = "voxel_engine.log";
+    if (options.shardIndex >= 0) logName = "voxel_engine.shard" + std::to_string(options.shardIndex) + ".log";
+    gLogFile.open(logName, std::ios::out | std::ios::trunc);
     if (gLogFile.is_open()) {
         gLogFile << "voxel_engine start\n";
         gLogFile.flush();
     }
 
-    if (std::getenv("VOXEL_VK_DEBUG")) {
-        enableDebug = true;
-    }
-    for (int i = 1; i < argc; ++i) {
-        std::string arg = argv[i];
-        if (arg == "--vk-debug") enableDebug = true;
-        if (arg == "--vk-nodebug") enableDebug = false;
+    if (!options.batchCameras.empty() && options.shardIndex < 0 && (options.batchShards > 1 || options.batchScaling)) {
+        return runBatchShards(argv[0], std::vector<std::string>(argv + 1, argv + argc), options);
     }
 
-        VulkanApp app(enableDebug);
+        VulkanApp app(options);
         app.run();
     return 0;
 }
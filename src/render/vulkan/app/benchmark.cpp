@@ -0,0 +1,403 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Benchmark runs fly a fixed path so numbers from different builds and shader
+// changes are comparable; results go to a JSON file next to the binary.
+
+static std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+static std::string distributionJson(std::vector<double> values) {
+    if (values.empty()) return "null";
+    std::sort(values.begin(), values.end());
+    auto pct = [&](double p) {
+        size_t idx = static_cast<size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+        return values[idx];
+    };
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "{ \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+                  sum / static_cast<double>(values.size()), pct(0.50), pct(0.95), pct(0.99), values.back());
+    return buf;
+}
+
+void VulkanAppImpl::updateBenchmarkCamera(double elapsed) {
+    // Climb out of the start position, then cruise over the terrain while
+    // looking left and right so both near detail and the horizon get exercised.
+    float t = static_cast<float>(elapsed);
+    cameraYaw = -1.5707963f + 0.6f * std::sin(0.2f * t);
+    cameraPitch = -0.25f;
+    cameraForward = vnorm({std::cos(cameraPitch) * std::cos(cameraYaw),
+                           std::sin(cameraPitch),
+                           std::cos(cameraPitch) * std::sin(cameraYaw)});
+    Vec3 up = {0.0f, 1.0f, 0.0f};
+    cameraRight = vnorm(vcross(cameraForward, up));
+    cameraUp = vcross(cameraRight, cameraForward);
+
+    cameraPos = {0.0f, std::min(40.0f, 1.5f + 10.0f * t), 6.0f - 40.0f * t};
+}
+
+void VulkanAppImpl::writeBenchmarkReport() {
+    std::ofstream out(options.benchmarkOutput, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) return;
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+    char buf[256];
+    out << "{\n";
+    out << "  \"device\": \"" << jsonEscape(props.deviceName) << "\",\n";
+    std::snprintf(buf, sizeof(buf), "  \"driver_version\": %u,\n", props.driverVersion);
+    out << buf;
+    std::snprintf(buf, sizeof(buf), "  \"resolution\": [%u, %u],\n  \"raymarch_upscale\": %u,\n",
+                  swapchainExtent.width, swapchainExtent.height, RAYMARCH_UPSCALE);
+    out << buf;
+    out << "  \"async_compute\": " << (asyncComputeEnabled ? "true" : "false") << ",\n";
+    out << "  \"present_mode\": \"" << presentModeLabel << "\",\n";
+    out << "  \"temporal_mode\": \"" << options.temporalMode << "\",\n";
+    std::snprintf(buf, sizeof(buf), "  \"frame_limit\": %.1f,\n", options.frameLimit);
+    out << buf;
+    std::snprintf(buf, sizeof(buf), "  \"duration_s\": %.3f,\n  \"frames\": %zu,\n",
+                  options.benchmarkSeconds, benchmarkStats.frameMs.size());
+    out << buf;
+    out << "  \"frame_ms\": " << distributionJson(benchmarkStats.frameMs) << ",\n";
+    out << "  \"gpu_raymarch_ms\": " << distributionJson(benchmarkStats.raymarchMs) << ",\n";
+    // Measured to present completion with VK_KHR_present_wait, otherwise to GPU completion.
+    out << "  \"input_to_present_ms\": " << distributionJson(benchmarkStats.latencyMs) << ",\n";
+    out << "  \"present_wait\": " << (waitForPresent ? "true" : "false") << ",\n";
+    std::snprintf(buf, sizeof(buf), "  \"height_cache\": { \"updates\": %u, \"avg_ms\": %.4f },\n",
+                  benchmarkStats.heightCacheUpdates,
+                  benchmarkStats.heightCacheUpdates ? benchmarkStats.heightCacheMs / benchmarkStats.heightCacheUpdates : 0.0);
+    out << buf;
+
+    std::snprintf(buf, sizeof(buf), "  \"startup\": { \"init_ms\": %.2f, \"first_frame_ms\": %.2f, \"steps\": [",
+                  initMs, firstFrameMs);
+    out << buf;
+    for (size_t i = 0; i < startupSteps.size(); i++) {
+        std::snprintf(buf, sizeof(buf), "%s{ \"name\": \"%s\", \"start_ms\": %.2f, \"ms\": %.2f }",
+                      i ? ", " : "", jsonEscape(startupSteps[i].name).c_str(), startupSteps[i].startMs, startupSteps[i].durationMs);
+        out << buf;
+    }
+    out << "] },\n";
+
+    const auto& heaps = memoryTracker.heaps();
+    out << "  \"memory\": { \"budget_extension\": " << (memoryTracker.budgetAvailable() ? "true" : "false")
+        << ", \"height_cache_levels\": " << heightCacheLevels << ", \"heaps\": [";
+    for (size_t i = 0; i < heaps.size(); i++) {
+        std::snprintf(buf, sizeof(buf),
+                      "%s{ \"size\": %llu, \"budget\": %llu, \"usage\": %llu, \"engine\": %llu, \"device_local\": %s }",
+                      i ? ", " : "", static_cast<unsigned long long>(heaps[i].size),
+                      static_cast<unsigned long long>(heaps[i].budget), static_cast<unsigned long long>(heaps[i].usage),
+                      static_cast<unsigned long long>(heaps[i].trackedUsage), heaps[i].deviceLocal ? "true" : "false");
+        out << buf;
+    }
+    HostAllocationStats host = hostAllocationStats();
+    std::snprintf(buf, sizeof(buf), "], \"host\": { \"bytes\": %llu, \"peak_bytes\": %llu, \"allocations\": %llu } },\n",
+                  static_cast<unsigned long long>(host.bytes), static_cast<unsigned long long>(host.peakBytes),
+                  static_cast<unsigned long long>(host.totalAllocations));
+    out << buf;
+
+    out << "  \"pipelines\": [";
+    for (size_t p = 0; p < pipelineReports.size(); p++) {
+        const auto& report = pipelineReports[p];
+        out << (p ? ",\n" : "\n") << "    { \"name\": \"" << jsonEscape(report.name) << "\", \"executables\": [";
+        for (size_t e = 0; e < report.executables.size(); e++) {
+            const auto& exec = report.executables[e];
+            out << (e ? ", " : "") << "{ \"name\": \"" << jsonEscape(exec.name) << "\", \"subgroup_size\": "
+                << exec.subgroupSize << ", \"statistics\": {";
+            for (size_t s = 0; s < exec.statistics.size(); s++) {
+                out << (s ? ", " : " ") << "\"" << jsonEscape(exec.statistics[s].name) << "\": " << exec.statistics[s].value;
+            }
+            out << " } }";
+        }
+        out << "] }";
+    }
+    out << (pipelineReports.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        gLogFile << "benchmark: " << benchmarkStats.frameMs.size() << " frames written to " << options.benchmarkOutput << '\n';
+        gLogFile.flush();
+    }
+}
+
+// Each raymarch building block timed on its own: bench_kernels.comp runs one
+// per pipeline over a KERNEL_BENCH_GRID^2 grid of synthetic inputs,
+// KERNEL_BENCH_ITERATIONS chained evaluations per invocation. After a warm-up
+// dispatch, KERNEL_BENCH_REPEATS dispatches are timed separately with a
+// barrier in between, and evaluations per second come from the median one.
+// The workload is fixed, so results compare across devices and commits.
+void VulkanAppImpl::runKernelBenchmark() {
+    struct Kernel {
+        const char* name;
+        int32_t id;
+    };
+    const Kernel kernels[] = {
+        { "simplex3", 0 },
+        { "fbm2D", 1 },
+        { "terrainHeight", 2 },
+        { "cellCheckLOD", 3 },
+        { "ddaStep", 4 },
+        { "traceMicro", 5 },
+    };
+    if (graphicsTimestampMask == 0 || timestampPeriod <= 0.0f) {
+        throw std::runtime_error("Failed to time kernels: the graphics queue has no timestamps");
+    }
+    // Opened first so an unwritable path fails before the suite runs.
+    std::ofstream out(options.kernelBenchOutput, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open kernel benchmark output " + options.kernelBenchOutput);
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = static_cast<VkDeviceSize>(KERNEL_BENCH_GRID) * KERNEL_BENCH_GRID * sizeof(float);
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer resultBuffer{};
+    if (vkCreateBuffer(device, &bufferInfo, gVkAllocator, &resultBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create kernel benchmark buffer");
+    }
+    VkMemoryRequirements req{};
+    vkGetBufferMemoryRequirements(device, resultBuffer, &req);
+    VkMemoryAllocateInfo alloc{};
+    alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkDeviceMemory resultMemory{};
+    if (memoryTracker.allocate(alloc, &resultMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate kernel benchmark memory");
+    }
+    vkBindBufferMemory(device, resultBuffer, resultMemory, 0);
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+    setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutInfo.bindingCount = 1;
+    setLayoutInfo.pBindings = &binding;
+    VkDescriptorSetLayout setLayout{};
+    if (vkCreateDescriptorSetLayout(device, &setLayoutInfo, gVkAllocator, &setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create kernel benchmark descriptor set layout");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 1;
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    VkDescriptorPool descriptorPool{};
+    if (vkCreateDescriptorPool(device, &poolInfo, gVkAllocator, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create kernel benchmark descriptor pool");
+    }
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = 1;
+    setInfo.pSetLayouts = &setLayout;
+    VkDescriptorSet descriptorSet{};
+    if (vkAllocateDescriptorSets(device, &setInfo, &descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate kernel benchmark descriptor set");
+    }
+    VkDescriptorBufferInfo resultInfo{};
+    resultInfo.buffer = resultBuffer;
+    resultInfo.range = VK_WHOLE_SIZE;
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &resultInfo;
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.size = sizeof(int32_t) * 4;
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &setLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    VkPipelineLayout pipelineLayout{};
+    if (vkCreatePipelineLayout(device, &layoutInfo, gVkAllocator, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create kernel benchmark pipeline layout");
+    }
+
+    auto code = readFile("shaders/bench_kernels.comp.spv");
+    VkShaderModule module = createShaderModule(code);
+    const size_t kernelCount = sizeof(kernels) / sizeof(kernels[0]);
+    std::vector<VkSpecializationMapEntry> entries(kernelCount);
+    std::vector<VkSpecializationInfo> specializations(kernelCount);
+    std::vector<VkComputePipelineCreateInfo> pipelineInfos(kernelCount);
+    for (size_t k = 0; k < kernelCount; k++) {
+        entries[k].constantID = 0;
+        entries[k].size = sizeof(int32_t);
+        specializations[k].mapEntryCount = 1;
+        specializations[k].pMapEntries = &entries[k];
+        specializations[k].dataSize = sizeof(int32_t);
+        specializations[k].pData = &kernels[k].id;
+
+        pipelineInfos[k].sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfos[k].stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfos[k].stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfos[k].stage.module = module;
+        pipelineInfos[k].stage.pName = "main";
+        pipelineInfos[k].stage.pSpecializationInfo = &specializations[k];
+        pipelineInfos[k].layout = pipelineLayout;
+    }
+    std::vector<VkPipeline> pipelines(kernelCount);
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, static_cast<uint32_t>(kernelCount),
+                                               pipelineInfos.data(), gVkAllocator, pipelines.data());
+    vkDestroyShaderModule(device, module, gVkAllocator);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create kernel benchmark pipelines");
+    }
+
+    VkQueryPoolCreateInfo queryInfo{};
+    queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryInfo.queryCount = KERNEL_BENCH_REPEATS * 2;
+    VkQueryPool queryPool{};
+    if (vkCreateQueryPool(device, &queryInfo, gVkAllocator, &queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create kernel benchmark query pool");
+    }
+
+    VkCommandBufferAllocateInfo cmdInfo{};
+    cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmdInfo.commandPool = commandPool;
+    cmdInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdInfo.commandBufferCount = 1;
+    VkCommandBuffer cmd{};
+    if (vkAllocateCommandBuffers(device, &cmdInfo, &cmd) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate kernel benchmark command buffer");
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    const int32_t params[4] = { static_cast<int32_t>(KERNEL_BENCH_GRID), static_cast<int32_t>(KERNEL_BENCH_ITERATIONS),
+                                KERNEL_BENCH_LOD, 0 };
+    const uint32_t groups = (KERNEL_BENCH_GRID + 15) / 16;
+    const double evaluations = static_cast<double>(KERNEL_BENCH_GRID) * KERNEL_BENCH_GRID * KERNEL_BENCH_ITERATIONS;
+
+    char buf[256];
+    out << "{\n";
+    out << "  \"device\": \"" << jsonEscape(props.deviceName) << "\",\n";
+    std::snprintf(buf, sizeof(buf), "  \"driver_version\": %u,\n  \"api_version\": %u,\n", props.driverVersion, props.apiVersion);
+    out << buf;
+    std::snprintf(buf, sizeof(buf), "  \"grid\": %u,\n  \"iterations\": %u,\n  \"repeats\": %u,\n  \"cell_check_lod\": %d,\n",
+                  KERNEL_BENCH_GRID, KERNEL_BENCH_ITERATIONS, KERNEL_BENCH_REPEATS, KERNEL_BENCH_LOD);
+    out << buf;
+    out << "  \"kernels\": [";
+
+    for (size_t k = 0; k < kernelCount; k++) {
+        vkResetCommandBuffer(cmd, 0);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmd, &beginInfo);
+        vkCmdResetQueryPool(cmd, queryPool, 0, KERNEL_BENCH_REPEATS * 2);
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[k]);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), params);
+
+        // Dispatch 0 is the warm-up; the barrier keeps timed dispatches from overlapping.
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        for (uint32_t r = 0; r <= KERNEL_BENCH_REPEATS; r++) {
+            if (r > 0) vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, (r - 1) * 2);
+            vkCmdDispatch(cmd, groups, groups, 1);
+            if (r > 0) vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, (r - 1) * 2 + 1);
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+        if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record kernel benchmark command buffer");
+        }
+
+        vkResetFences(device, 1, &inFlightFence);
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &cmd;
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit kernel benchmark");
+        }
+        vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+
+        std::vector<uint64_t> ts(KERNEL_BENCH_REPEATS * 2);
+        if (vkGetQueryPoolResults(device, queryPool, 0, KERNEL_BENCH_REPEATS * 2, ts.size() * sizeof(uint64_t), ts.data(),
+                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to read kernel benchmark timestamps");
+        }
+        std::vector<double> ms;
+        for (uint32_t r = 0; r < KERNEL_BENCH_REPEATS; r++) {
+            uint64_t ticks = (ts[r * 2 + 1] - ts[r * 2]) & graphicsTimestampMask;
+            ms.push_back(static_cast<double>(ticks) * timestampPeriod * 1e-6);
+        }
+        std::vector<double> sorted = ms;
+        std::sort(sorted.begin(), sorted.end());
+        double median = sorted[sorted.size() / 2];
+        double perSecond = median > 0.0 ? evaluations / (median * 1e-3) : 0.0;
+
+        std::snprintf(buf, sizeof(buf), "%s\n    { \"name\": \"%s\", \"evaluations\": %.0f, \"best_ms\": %.4f, \"median_ms\": %.4f, ",
+                      k ? "," : "", kernels[k].name, evaluations, sorted.front(), median);
+        out << buf;
+        std::snprintf(buf, sizeof(buf), "\"evaluations_per_second\": %.4e, \"ms\": ", perSecond);
+        out << buf << distributionJson(ms) << " }";
+
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) {
+            std::snprintf(buf, sizeof(buf), "kernel benchmark: %-14s %8.3f ms median, %.3f G evaluations/s\n",
+                          kernels[k].name, median, perSecond * 1e-9);
+            gLogFile << buf;
+            gLogFile.flush();
+        }
+    }
+    out << "\n  ]\n}\n";
+
+    vkFreeCommandBuffers(device, commandPool, 1, &cmd);
+    vkDestroyQueryPool(device, queryPool, gVkAllocator);
+    for (VkPipeline pipeline : pipelines) vkDestroyPipeline(device, pipeline, gVkAllocator);
+    vkDestroyPipelineLayout(device, pipelineLayout, gVkAllocator);
+    vkDestroyDescriptorPool(device, descriptorPool, gVkAllocator);
+    vkDestroyDescriptorSetLayout(device, setLayout, gVkAllocator);
+    vkDestroyBuffer(device, resultBuffer, gVkAllocator);
+    memoryTracker.free(resultMemory);
+}
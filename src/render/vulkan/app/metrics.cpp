@@ -0,0 +1,38 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+// Metrics are always recorded; --metrics-port only decides whether anything
+// can scrape them. Cache reuse is reported as pairs of counters (reused and
+// total, or hits and misses) so a dashboard can take rates over any window.
+
+void VulkanAppImpl::registerMetrics() {
+    const std::vector<double> frameBounds = { 2, 4, 6, 8, 11.1, 16.7, 20, 25, 33.3, 50, 100, 250 };
+    const std::vector<double> passBounds = { 0.25, 0.5, 1, 2, 3, 4, 6, 8, 12, 16, 25, 50 };
+
+    metrics.frameMs = &gMetrics.histogram("voxel_frame_time_ms", "Render loop frame interval in milliseconds.", frameBounds);
+    metrics.latencyMs = &gMetrics.histogram("voxel_input_to_present_ms",
+                                            "Input sample to present (or GPU completion without present_wait) in milliseconds.",
+                                            frameBounds);
+    metrics.raymarchMs = &gMetrics.histogram("voxel_gpu_raymarch_ms", "GPU time of the raymarch pass in milliseconds.", passBounds);
+    metrics.heightCacheMs = &gMetrics.histogram("voxel_gpu_height_cache_ms", "GPU time of a height cache update in milliseconds.", passBounds);
+    metrics.frames = &gMetrics.counter("voxel_frames_total", "Frames recorded.");
+    metrics.historyReused = &gMetrics.counter("voxel_history_reused_frames_total", "Frames that reprojected a valid history.");
+    metrics.farReused = &gMetrics.counter("voxel_far_layer_reused_frames_total", "Frames that reused the cached far layer.");
+    metrics.heightCacheHits = &gMetrics.counter("voxel_height_cache_hits_total", "Frames whose height cache was already centered.");
+    metrics.heightCacheMisses = &gMetrics.counter("voxel_height_cache_misses_total", "Height cache updates scheduled.");
+    metrics.capturesDropped = &gMetrics.counter("voxel_capture_dropped_frames_total", "Captured frames dropped for lack of a free slot.");
+    metrics.deviceMemoryUsage = &gMetrics.gauge("voxel_device_memory_usage_bytes", "Usage of the primary device-local heap.");
+    metrics.deviceMemoryBudget = &gMetrics.gauge("voxel_device_memory_budget_bytes", "Budget of the primary device-local heap.");
+    metrics.hostMemory = &gMetrics.gauge("voxel_host_driver_memory_bytes", "Host memory the driver allocated through our callbacks.");
+    metrics.captureSlotsBusy = &gMetrics.gauge("voxel_capture_queue_depth", "Capture slots waiting for or held by the encoder.");
+    metrics.serverQueue = &gMetrics.gauge("voxel_server_queue_depth", "Render server requests waiting for a batch.");
+}
+
+void VulkanAppImpl::updateMemoryMetrics() {
+    const auto& heaps = memoryTracker.heaps();
+    uint32_t primary = memoryTracker.primaryHeap();
+    if (primary < heaps.size()) {
+        metrics.deviceMemoryUsage->set(static_cast<double>(heaps[primary].usage));
+        metrics.deviceMemoryBudget->set(static_cast<double>(heaps[primary].budget));
+    }
+    metrics.hostMemory->set(static_cast<double>(hostAllocationStats().bytes));
+}
@@ -0,0 +1,49 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <cstdio>
+
+// Every init step is timed relative to the start of run(), on whichever
+// thread it runs, so overlapping steps show up as overlapping ranges.
+
+static double millisecondsSince(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void VulkanAppImpl::timeStartupStep(const char* name, const std::function<void()>& step) {
+    ProfileZone zone(name);
+    double start = millisecondsSince(startupBegin);
+    step();
+    double end = millisecondsSince(startupBegin);
+
+    std::lock_guard<std::mutex> lock(startupMutex);
+    startupSteps.push_back({ name, start, end - start });
+}
+
+void VulkanAppImpl::noteFirstFramePresented() {
+    if (firstFrameMs > 0.0) return;
+    firstFrameMs = millisecondsSince(startupBegin);
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "startup: first frame presented after %.1f ms\n", firstFrameMs);
+        gLogFile << line;
+        gLogFile.flush();
+    }
+}
+
+void VulkanAppImpl::logStartupTimings() {
+    initMs = millisecondsSince(startupBegin);
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (!gLogFile.is_open()) return;
+    char line[160];
+    for (const auto& step : startupSteps) {
+        std::snprintf(line, sizeof(line), "startup: %-24s %8.1f ms .. %8.1f ms (%.1f ms)\n",
+                      step.name.c_str(), step.startMs, step.startMs + step.durationMs, step.durationMs);
+        gLogFile << line;
+    }
+    std::snprintf(line, sizeof(line), "startup: init finished after %.1f ms\n", initMs);
+    gLogFile << line;
+    gLogFile.flush();
+}
@@ -4,58 +4,153 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <exception>
+#include <future>
 
-VulkanAppImpl::VulkanAppImpl(bool enableValidation)
-    : validationEnabled(enableValidation) {}
+VulkanAppImpl::VulkanAppImpl(const AppOptions& appOptions)
+    : options(appOptions), validationEnabled(appOptions.enableValidation) {
+    gProfilerEnabled = !options.traceOutput.empty();
+    registerMetrics();
+}
 
 void VulkanAppImpl::run() {
+    startupBegin = std::chrono::steady_clock::now();
+    if (options.metricsPort != 0 && !metricsServer.start(static_cast<uint16_t>(options.metricsPort))) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) gLogFile << "metrics: cannot listen on port " << options.metricsPort << '\n';
+    }
+    if (headless()) {
+        startInstanceCreation();
+        initVulkan();
+        if (!options.kernelBenchOutput.empty()) runKernelBenchmark();
+        else if (!options.serveSocket.empty()) serveRequests();
+        else if (!options.batchCameras.empty()) renderBatch();
+        else if (!options.replayInput.empty()) replayHeadless();
+        else renderScreenshot();
+        cleanup();
+        return;
+    }
     initWindow();
     initVulkan();
     mainLoop();
     cleanup();
 }
 
+// Screenshots, batch renders, the render server, the kernel benchmark and
+// headless replays run without a window, surface or swapchain.
+bool VulkanAppImpl::headless() const {
+    return !options.screenshotOutput.empty() || !options.batchCameras.empty() || !options.serveSocket.empty() ||
+           !options.kernelBenchOutput.empty() || (!options.replayInput.empty() && options.replayHeadless);
+}
+
+// Loading the drivers in vkCreateInstance is the slowest part of startup and
+// does not need the window, so the two overlap.
+void VulkanAppImpl::startInstanceCreation() {
+    instanceTask = std::async(std::launch::async, [this] {
+        timeStartupStep("instance", [this] {
+            if (validationEnabled && !validationLayersSupported()) {
+                validationEnabled = false;
+            }
+            createInstance();
+            setupDebugMessenger();
+        });
+    });
+}
+
 void VulkanAppImpl::initWindow() {
     if (!glfwInit()) throw std::runtime_error("Failed to init GLFW");
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-    window = glfwCreateWindow(static_cast<int>(WIDTH), static_cast<int>(HEIGHT), "Voxel Engine", nullptr, nullptr);
+    startInstanceCreation();
+
+    timeStartupStep("window", [this] {
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        window = glfwCreateWindow(static_cast<int>(WIDTH), static_cast<int>(HEIGHT), "Voxel Engine", nullptr, nullptr);
+    });
     if (!window) throw std::runtime_error("Failed to create GLFW window");
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     cursorLocked = true;
 }
 
 void VulkanAppImpl::initVulkan() {
-    if (validationEnabled && !validationLayersSupported()) {
-        validationEnabled = false;
-    }
-    createInstance();
-    setupDebugMessenger();
-    createSurface();
-    pickPhysicalDevice();
-    createLogicalDevice();
-    createSwapchain();
-    createImageViews();
+    instanceTask.get();
+    if (!headless()) timeStartupStep("surface", [this] { createSurface(); });
+    timeStartupStep("physical device", [this] { pickPhysicalDevice(); });
+    timeStartupStep("logical device", [this] { createLogicalDevice(); });
+
+    // Pipelines only need the device and their set layouts, so shader loading
+    // and compilation run on worker threads while the swapchain and buffers
+    // are created.
     createComputeDescriptorSetLayout();
-    createComputePipeline();
-    createComputeDescriptorPool();
-    createCameraBuffer();
-    initCamera();
-    createComputeDescriptorSets();
-    createCommandPool();
-    createCommandBuffers();
-    createSyncObjects();
+    createHeightCacheSetLayout();
+    auto raymarchPipelineTask = std::async(std::launch::async, [this] {
+        timeStartupStep("raymarch pipeline", [this] { createComputePipeline(); });
+    });
+    auto heightCachePipelineTask = std::async(std::launch::async, [this] {
+        timeStartupStep("height cache pipeline", [this] { createHeightCachePipeline(); });
+    });
+
+    timeStartupStep("swapchain", [this] {
+        if (headless()) createOffscreenTarget();
+        else createSwapchain();
+        createImageViews();
+    });
+    timeStartupStep("buffers", [this] {
+        createComputeDescriptorPool();
+        createCameraBuffer();
+        createHeightCache();
+        createRenderStatsBuffer();
+        createCostMapBuffer();
+        createStructureAtlas();
+        createCaptureRing();
+        initTemporal();
+        createHistoryImage();
+        createFarField();
+        createTimestampQueries();
+        initCamera();
+    });
+
+    raymarchPipelineTask.get();
+    heightCachePipelineTask.get();
+    timeStartupStep("descriptors and commands", [this] {
+        createComputeDescriptorSets();
+        createCommandPool();
+        createCommandBuffers();
+        createSyncObjects();
+    });
+    writePipelineReport();
+    logStartupTimings();
     fpsTimeAccum = 0.0;
     fpsFrameCount = 0;
 }
 
+// The main thread only handles window events and input and publishes a camera
+// snapshot per iteration; the render thread owns every Vulkan queue operation
+// and picks up the newest snapshot right before it records a frame, so a slow
+// event callback or a blocking acquire/present never stalls the other side.
 void VulkanAppImpl::mainLoop() {
+    setProfilerThreadName("main");
     double lastTime = glfwGetTime();
-    while (!glfwWindowShouldClose(window)) {
+    benchmarkStart = lastTime;
+    bool replaying = !options.replayInput.empty();
+    if (replaying) loadReplay();
+    else if (!options.recordInput.empty() && !options.benchmark) startInputRecording();
+    trackCameraMotion(lastTime);
+    publishCameraSnapshot(lastTime);
+    renderStop = false;
+    renderThread = std::thread(&VulkanAppImpl::renderLoop, this);
+
+    while (!glfwWindowShouldClose(window) && !renderStop) {
+        {
+            PROFILE_ZONE("poll events");
+            // Nothing but input changes a converged image, so the thread
+            // sleeps until an event arrives; replays and the benchmark move
+            // the camera on their own clock.
+            if (renderConverged && !replaying && !options.benchmark) glfwWaitEvents();
+            else glfwWaitEventsTimeout(INPUT_POLL_SECONDS);
+        }
         double now = glfwGetTime();
         float dt = static_cast<float>(now - lastTime);
         lastTime = now;
-        glfwPollEvents();
 
         if (cursorLocked && glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
@@ -69,82 +164,289 @@ void VulkanAppImpl::mainLoop() {
             firstMouse = true;
         }
 
-        if (cursorLocked) {
-            updateCamera(dt);
-            updateCameraBuffer();
+        // A replay with --benchmark reports the frames of the replay instead
+        // of the benchmark path.
+        if (replaying) {
+            benchmarkRecording = options.benchmark;
+            if (!advanceReplay(now - benchmarkStart)) glfwSetWindowShouldClose(window, GLFW_TRUE);
+        } else if (options.benchmark) {
+            double elapsed = now - benchmarkStart;
+            updateBenchmarkCamera(elapsed);
+            benchmarkRecording = elapsed >= BENCHMARK_WARMUP_SECONDS;
+            if (elapsed >= BENCHMARK_WARMUP_SECONDS + options.benchmarkSeconds) glfwSetWindowShouldClose(window, GLFW_TRUE);
+        } else {
+            InputSample input;
+            input.dt = dt;
+            if (cursorLocked) input = sampleCameraInput(dt);
+            applyCameraInput(input);
+            recordInput(input);
         }
+        trackCameraMotion(now);
+        publishCameraSnapshot(now);
 
-        fpsTimeAccum += dt;
-        fpsFrameCount += 1;
-        if (fpsTimeAccum >= 0.5) {
-            double fps = static_cast<double>(fpsFrameCount) / fpsTimeAccum;
-            fpsTimeAccum = 0.0;
-            fpsFrameCount = 0;
-
-            char title[128];
-            std::snprintf(title, sizeof(title), "Voxel Engine - %.1f FPS", fps);
-            glfwSetWindowTitle(window, title);
+        if (titleDirty.exchange(false)) {
+            std::lock_guard<std::mutex> lock(titleMutex);
+            glfwSetWindowTitle(window, windowTitle.c_str());
         }
+    }
 
-        drawFrame();
+    renderStop = true;
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        snapshotPublished.notify_one();
     }
+    renderThread.join();
+    inputRecorder.stop();
     vkDeviceWaitIdle(device);
+    finishCapture();
+    memoryTracker.refresh();
+    logMemoryUsage();
+
+    if (options.benchmark) {
+        collectGpuTimings();
+        writeBenchmarkReport();
+    }
+    if (renderError) std::rethrow_exception(renderError);
+}
+
+void VulkanAppImpl::publishCameraSnapshot(double now) {
+    cameraSnapshots.write(cameraSnapshot(now));
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    snapshotPublished.notify_one();
+}
+
+void VulkanAppImpl::renderLoop() {
+    setProfilerThreadName("render");
+    try {
+        double lastTime = glfwGetTime();
+        while (!renderStop) {
+            // A converged still image stays on screen; nothing is drawn until
+            // a snapshot with a different view arrives.
+            if (refinementConverged()) {
+                renderConverged = true;
+                {
+                    std::unique_lock<std::mutex> lock(snapshotMutex);
+                    snapshotPublished.wait(lock, [this] { return renderStop || !refinementConverged(); });
+                }
+                renderConverged = false;
+                lastTime = glfwGetTime();
+                continue;
+            }
+
+            double iterationStart = glfwGetTime();
+            waitForNextFrame();
+            double now = glfwGetTime();
+            double dt = now - lastTime;
+            lastTime = now;
+            if (benchmarkRecording) benchmarkStats.frameMs.push_back(dt * 1000.0);
+            metrics.frameMs->observe(dt * 1000.0);
+
+            drawFrame();
+            framesDrawn.fetch_add(1, std::memory_order_relaxed);
+            commitFrameRecord(iterationStart, glfwGetTime() - iterationStart);
+
+            fpsTimeAccum += dt;
+            fpsFrameCount += 1;
+            if (fpsTimeAccum >= 0.5) {
+                reportFrameStats(now);
+            }
+        }
+    } catch (...) {
+        renderError = std::current_exception();
+    }
+    renderStop = true;
+    glfwPostEmptyEvent();
+}
+
+void VulkanAppImpl::reportFrameStats(double now) {
+    double fps = static_cast<double>(fpsFrameCount) / fpsTimeAccum;
+    fpsTimeAccum = 0.0;
+    fpsFrameCount = 0;
+
+    char title[160];
+    int len = std::snprintf(title, sizeof(title), "Voxel Engine - %.1f FPS", fps);
+    if (gpuTimings.frames > 0) {
+        len += std::snprintf(title + len, sizeof(title) - len, " - raymarch %.2f ms",
+                             gpuTimings.raymarchMs / gpuTimings.frames);
+    }
+    if (latencyFrames > 0) {
+        std::snprintf(title + len, sizeof(title) - len, " - input to present %.1f ms%s",
+                      latencyAccumMs / latencyFrames, waitForPresent ? "" : " (est.)");
+    }
+    {
+        std::lock_guard<std::mutex> lock(titleMutex);
+        windowTitle = title;
+    }
+    titleDirty = true;
+    glfwPostEmptyEvent();
+    latencyAccumMs = 0.0;
+    latencyFrames = 0;
+
+    if (gpuTimings.heightCacheUpdates > 0) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) {
+            // Without calibrated timestamps the two queues' ticks cannot be compared.
+            char overlap[32] = "n/a";
+            if (gpuTimings.overlapUpdates > 0) {
+                std::snprintf(overlap, sizeof(overlap), "%.3f ms", gpuTimings.overlapMs / gpuTimings.overlapUpdates);
+            }
+            char line[192];
+            std::snprintf(line, sizeof(line),
+                          "height cache: %u updates, %.3f ms avg on %s queue, %s avg overlapped with raymarch\n",
+                          gpuTimings.heightCacheUpdates,
+                          gpuTimings.heightCacheMs / gpuTimings.heightCacheUpdates,
+                          asyncComputeEnabled ? "async compute" : "graphics", overlap);
+            gLogFile << line;
+            gLogFile.flush();
+        }
+    }
+    gpuTimings = {};
+    updateMemoryBudget(now);
+    updateMemoryMetrics();
 }
 
 void VulkanAppImpl::cleanup() {
+    metricsServer.stop();
     vkDeviceWaitIdle(device);
+    if (!options.renderStatsOutput.empty()) {
+        collectRenderStats();
+        writeRenderStats();
+    }
+    if (costMapMapped && !options.costHeatmapOutput.empty()) {
+        collectCostMap();
+        writeCostHeatmap();
+    }
 
-    vkDestroyFence(device, inFlightFence, nullptr);
-    vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-    vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
+    vkDestroyFence(device, inFlightFence, gVkAllocator);
+    vkDestroySemaphore(device, renderFinishedSemaphore, gVkAllocator);
+    vkDestroySemaphore(device, imageAvailableSemaphore, gVkAllocator);
+    if (computeTimeline) vkDestroySemaphore(device, computeTimeline, gVkAllocator);
+    if (timestampPool) vkDestroyQueryPool(device, timestampPool, gVkAllocator);
 
-    vkDestroyBuffer(device, cameraBuffer, nullptr);
-    vkFreeMemory(device, cameraBufferMemory, nullptr);
+    frameGraph.destroy();
+    destroyCaptureRing();
+    destroyHistoryImage();
+    destroyFarField();
+    destroyHeightCache();
+    destroyRenderStatsBuffer();
+    destroyCostMapBuffer();
+    destroyStructureAtlas();
+    vkDestroyBuffer(device, cameraBuffer, gVkAllocator);
+    memoryTracker.free(cameraBufferMemory);
 
-    vkDestroyPipeline(device, computePipeline, nullptr);
-    vkDestroyPipelineLayout(device, computePipelineLayout, nullptr);
-    vkDestroyDescriptorPool(device, computeDescriptorPool, nullptr);
-    vkDestroyDescriptorSetLayout(device, computeDescriptorSetLayout, nullptr);
+    vkDestroyPipeline(device, computePipeline, gVkAllocator);
+    vkDestroyPipeline(device, farFieldPipeline, gVkAllocator);
+    vkDestroyPipelineLayout(device, computePipelineLayout, gVkAllocator);
+    vkDestroyDescriptorPool(device, computeDescriptorPool, gVkAllocator);
+    vkDestroyDescriptorSetLayout(device, computeDescriptorSetLayout, gVkAllocator);
 
-    for (auto view : swapchainImageViews) vkDestroyImageView(device, view, nullptr);
+    for (auto view : swapchainImageViews) vkDestroyImageView(device, view, gVkAllocator);
 
-    vkDestroySwapchainKHR(device, swapchain, nullptr);
-    vkDestroyCommandPool(device, commandPool, nullptr);
-    vkDestroyDevice(device, nullptr);
+    if (swapchain) vkDestroySwapchainKHR(device, swapchain, gVkAllocator);
+    if (offscreenMemory) destroyOffscreenTarget();
+    vkDestroyCommandPool(device, commandPool, gVkAllocator);
+    if (computeCommandPool) vkDestroyCommandPool(device, computeCommandPool, gVkAllocator);
+    vkDestroyDevice(device, gVkAllocator);
 
     if (validationEnabled && debugMessenger) {
-        DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+        DestroyDebugUtilsMessengerEXT(instance, debugMessenger, gVkAllocator);
     }
 
-    vkDestroySurfaceKHR(instance, surface, nullptr);
-    vkDestroyInstance(instance, nullptr);
+    if (surface) vkDestroySurfaceKHR(instance, surface, gVkAllocator);
+    vkDestroyInstance(instance, gVkAllocator);
+
+    if (window) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (!options.traceOutput.empty()) {
+        bool written = writeChromeTrace(options.traceOutput);
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) {
+            gLogFile << "trace: " << (written ? "written to " : "failed to write ") << options.traceOutput << '\n';
+            gLogFile.flush();
+        }
+    }
 }
 
 void VulkanAppImpl::drawFrame() {
+    PROFILE_ZONE("drawFrame");
     vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
-    vkResetFences(device, 1, &inFlightFence);
+
+    collectGpuTimings();
+    collectRenderStats();
+    collectCostMap();
+    collectCaptures();
 
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    VkResult result;
+    double stageStart = glfwGetTime();
+    {
+        PROFILE_ZONE("acquire");
+        result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    }
+    double stageEnd = glfwGetTime();
+    currentFrame.acquireMs = (stageEnd - stageStart) * 1000.0;
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         return;
     } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
         throw std::runtime_error("Failed to acquire swapchain image");
     }
+    // Reset only once a submission is certain to follow, or the next wait hangs.
+    vkResetFences(device, 1, &inFlightFence);
+
+    // Newest camera state from the input thread, as late as possible.
+    CameraSnapshot previousCamera = renderCamera;
+    cameraSnapshots.read(renderCamera);
+    frameInputTime = renderCamera.inputTime;
+    frameReadTime = glfwGetTime();
+    updateRefinement(previousCamera);
+    scheduleHeightCacheUpdate();
+    updateCameraBuffer();
+    currentFrame.cameraPos = renderCamera.pos;
+    currentFrame.cameraForward = renderCamera.forward;
+    currentFrame.heightCacheUpdate = heightCacheUpdateSlot >= 0;
+    currentFrame.historyValid = historyValid;
+    currentFrame.farValid = farValid;
+    currentFrame.refineSamples = refineSamples;
+    stageStart = stageEnd;
+    stageEnd = glfwGetTime();
+    currentFrame.updateMs = (stageEnd - stageStart) * 1000.0;
 
     vkResetCommandBuffer(commandBuffers[imageIndex], 0);
     recordCommandBuffer(commandBuffers[imageIndex], imageIndex);
+    advanceHistory();
+    advanceFarField();
+    stageStart = stageEnd;
+    stageEnd = glfwGetTime();
+    currentFrame.recordMs = (stageEnd - stageStart) * 1000.0;
 
-    VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
+    // Passes the graph put on the async queue go first so graphics can wait on
+    // them; the raymarch also waits for the slot it reads to be complete.
+    bool computeSubmitted = frameGraph.hasWork(RenderQueue::Compute);
+    if (computeSubmitted) submitHeightCacheUpdate();
+    heightCacheUpdateSlot = -1;
+
+    VkSemaphore waitSemaphores[] = { imageAvailableSemaphore, computeTimeline };
+    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
+    uint64_t waitValues[] = { 0, heightCacheReadyValue };
+    if (computeSubmitted && frameGraph.graphicsWaitStages() != 0) {
+        waitValues[1] = computeTimelineValue;
+        waitStages[1] = static_cast<VkPipelineStageFlags>(frameGraph.graphicsWaitStages());
+    }
+    bool waitForCompute = asyncComputeEnabled && waitValues[1] > 0;
     VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
 
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = 2;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pNext = waitForCompute ? &timelineInfo : nullptr;
+    submitInfo.waitSemaphoreCount = waitForCompute ? 2 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
@@ -152,20 +454,43 @@ void VulkanAppImpl::drawFrame() {
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to submit draw command buffer");
+    {
+        PROFILE_ZONE("submit");
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit draw command buffer");
+        }
     }
+    stageStart = stageEnd;
+    stageEnd = glfwGetTime();
+    currentFrame.submitMs = (stageEnd - stageStart) * 1000.0;
 
     VkSwapchainKHR swapchains[] = { swapchain };
+    uint64_t presentId = presentIdValue + 1;
+    VkPresentIdKHR presentIdInfo{};
+    presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentIdInfo.swapchainCount = 1;
+    presentIdInfo.pPresentIds = &presentId;
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    presentInfo.pNext = waitForPresent ? &presentIdInfo : nullptr;
     presentInfo.waitSemaphoreCount = 1;
     presentInfo.pWaitSemaphores = signalSemaphores;
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapchains;
     presentInfo.pImageIndices = &imageIndex;
 
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    {
+        PROFILE_ZONE("present");
+        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
+    currentFrame.presentMs = (glfwGetTime() - stageEnd) * 1000.0;
+    if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+        presentIdValue = presentId;
+        latencyPendingInput = frameInputTime;
+        latencyPendingRead = frameReadTime;
+        noteFirstFramePresented();
+    }
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
         return;
     } else if (result != VK_SUCCESS) {
@@ -1,20 +1,42 @@
 #pragma once
 
 #include "render/vulkan/vulkan_debug.hpp"
+#include "render/vulkan/graph/render_graph.hpp"
+#include "render/vulkan/core/vk_memory.hpp"
+#include "render/vulkan/capture/frame_encoder.hpp"
 #include "core/logging.hpp"
+#include "core/options.hpp"
+#include "core/camera_list.hpp"
+#include "core/input_recording.hpp"
+#include "core/triple_buffer.hpp"
+#include "core/profiler.hpp"
+#include "core/metrics.hpp"
 
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 
 #include <vector>
+#include <string>
+#include <utility>
 #include <optional>
 #include <cstdint>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <unordered_map>
+#include <deque>
+#include <fstream>
 #include <cmath>
 
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> computeFamily;  // dedicated: compute without graphics
     bool isComplete() const { return graphicsFamily.has_value() && presentFamily.has_value(); }
 };
 
@@ -30,12 +52,195 @@ struct Vec3 {
     float z;
 };
 
+// Camera state handed from the input thread to the render thread. Velocity
+// and the yaw and pitch rates are per second, for predicting the camera to
+// the time the frame is displayed.
+struct CameraSnapshot {
+    Vec3 pos{};
+    Vec3 forward{};
+    Vec3 right{};
+    Vec3 up{};
+    double inputTime{};
+    float yaw{};
+    float pitch{};
+    Vec3 velocity{};
+    float yawRate{};
+    float pitchRate{};
+};
+
+struct CameraMotionSample {
+    double time{};
+    Vec3 pos{};
+    float yaw{};
+    float pitch{};
+};
+
+// Must match MAX_VIEWS in cube.comp.
+constexpr uint32_t MAX_RENDER_VIEWS = 4;
+
+// One camera and the part of the output it is drawn into. `window` is the
+// part of the camera's image plane the viewport shows (x, y, width, height as
+// fractions); screenshot tiles use it to render a sub-frustum.
+struct RenderView {
+    CameraSnapshot camera{};
+    VkRect2D viewport{};
+    float window[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+};
+
+struct ViewUBO {
+    float pos[4];
+    float forward[4];
+    float right[4];
+    float up[4];
+    float prevPos[4];
+    float prevForward[4];
+    float prevRight[4];
+    float prevUp[4];
+    int32_t viewport[4];
+    float window[4];
+};
+
 struct CameraUBO {
-    float camPos[4];
-    float camForward[4];
-    float camRight[4];
-    float camUp[4];
     float params[4];
+    int32_t heightCache[4];
+    int32_t refine[4];
+    int32_t temporal[4];
+    float farField[4];
+    int32_t farState[4];
+    int32_t viewCount[4];
+    ViewUBO views[MAX_RENDER_VIEWS];
+};
+
+enum TemporalMode : int32_t {
+    TEMPORAL_OFF = 0,
+    TEMPORAL_JITTER,
+    TEMPORAL_INTERLEAVED
+};
+
+enum TimestampQuery : uint32_t {
+    TS_RAYMARCH_BEGIN = 0,
+    TS_RAYMARCH_END,
+    TS_HEIGHT_CACHE_BEGIN,
+    TS_HEIGHT_CACHE_END,
+    TS_COUNT
+};
+
+struct GpuTimings {
+    double raymarchMs{};
+    double heightCacheMs{};
+    double overlapMs{};
+    uint32_t frames{};
+    uint32_t heightCacheUpdates{};
+    uint32_t overlapUpdates{}; // updates whose overlap could be measured
+};
+
+// Raymarch traversal counters summed over the run for --render-stats; the
+// histogram matches STATS_HISTOGRAM_BUCKETS in cube.comp.
+struct RenderStats {
+    uint64_t frames{};
+    uint64_t rays{};
+    uint64_t hits{};
+    uint64_t coarseSteps{};
+    uint64_t fineSteps{};
+    uint64_t stepHistogram[16]{};
+    std::vector<double> raymarchMs;
+};
+
+// Per-pixel sums of the raymarch's shader clock cycles for --cost-heatmap;
+// `samples` counts the frames that drew each pixel.
+struct CostHeatmap {
+    uint64_t frames{};
+    uint32_t width{};
+    uint32_t height{};
+    std::vector<uint64_t> traversal;
+    std::vector<uint64_t> total;
+    std::vector<uint32_t> samples;
+};
+
+// One render loop iteration as the flight recorder keeps it. CPU stages are
+// wall-clock milliseconds on the render thread; GPU times belong to the same
+// frame and are filled in a frame later, once its queries are read back.
+struct FrameRecord {
+    uint64_t index{};
+    double time{};
+    double frameMs{};
+    double fenceMs{};
+    double presentWaitMs{};
+    double limiterMs{};
+    double acquireMs{};
+    double updateMs{};
+    double recordMs{};
+    double submitMs{};
+    double presentMs{};
+    double gpuRaymarchMs{};
+    double gpuHeightCacheMs{};
+    Vec3 cameraPos{};
+    Vec3 cameraForward{};
+    bool heightCacheUpdate{};
+    bool historyValid{};
+    bool farValid{};
+    uint32_t refineSamples{};
+};
+
+// Handles into gMetrics, registered once so frames only touch atomics.
+struct RenderMetrics {
+    MetricHistogram* frameMs{};
+    MetricHistogram* latencyMs{};
+    MetricHistogram* raymarchMs{};
+    MetricHistogram* heightCacheMs{};
+    MetricCounter* frames{};
+    MetricCounter* historyReused{};
+    MetricCounter* farReused{};
+    MetricCounter* heightCacheHits{};
+    MetricCounter* heightCacheMisses{};
+    MetricCounter* capturesDropped{};
+    MetricGauge* deviceMemoryUsage{};
+    MetricGauge* deviceMemoryBudget{};
+    MetricGauge* hostMemory{};
+    MetricGauge* captureSlotsBusy{};
+    MetricGauge* serverQueue{};
+};
+
+struct PipelineStatistic {
+    std::string name;
+    std::string description;
+    std::string value;
+};
+
+struct PipelineExecutableReport {
+    std::string name;
+    std::string description;
+    uint32_t subgroupSize{};
+    std::vector<PipelineStatistic> statistics;
+    std::vector<std::pair<std::string, std::string>> representations;
+};
+
+struct PipelineReport {
+    std::string name;
+    std::vector<PipelineExecutableReport> executables;
+};
+
+struct CaptureSlot {
+    VkBuffer buffer{};
+    VkDeviceMemory memory{};
+    const uint8_t* pixels{};
+    uint64_t index{};
+    bool recorded{};                 // copy recorded, not yet handed to the encoder
+    std::atomic<bool> released{true}; // encoder is done with the pixels
+};
+
+struct StartupStep {
+    std::string name;
+    double startMs{};
+    double durationMs{};
+};
+
+struct BenchmarkStats {
+    std::vector<double> frameMs;
+    std::vector<double> raymarchMs;
+    std::vector<double> latencyMs;
+    double heightCacheMs{};
+    uint32_t heightCacheUpdates{};
 };
 
 inline Vec3 vadd(Vec3 a, Vec3 b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
@@ -55,14 +260,18 @@ inline Vec3 vnorm(Vec3 a) {
 
 class VulkanAppImpl {
 public:
-    explicit VulkanAppImpl(bool enableValidation);
+    explicit VulkanAppImpl(const AppOptions& appOptions);
     ~VulkanAppImpl() = default;
 
     void run();
 
+    bool headless() const;
+    void startInstanceCreation();
     void initWindow();
     void initVulkan();
     void mainLoop();
+    void renderLoop();
+    void reportFrameStats(double now);
     void cleanup();
 
     void createInstance();
@@ -73,6 +282,8 @@ public:
     uint64_t rateDevice(VkPhysicalDevice dev);
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice dev);
     bool checkDeviceExtensionSupport(VkPhysicalDevice dev);
+    bool hasDeviceExtension(VkPhysicalDevice dev, const char* name);
+    const std::vector<VkExtensionProperties>& deviceExtensionProperties(VkPhysicalDevice dev);
     SwapchainSupportDetails querySwapchainSupport(VkPhysicalDevice dev);
     void createLogicalDevice();
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
@@ -80,6 +291,8 @@ public:
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
     void createSwapchain();
     void createImageViews();
+    void createOffscreenTarget();
+    void destroyOffscreenTarget();
     static std::vector<char> readFile(const char* filename);
     VkShaderModule createShaderModule(const std::vector<char>& code);
     void createComputeDescriptorSetLayout();
@@ -92,10 +305,89 @@ public:
     void createSyncObjects();
     void recordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex);
     void drawFrame();
+    void waitForNextFrame();
+    void commitFrameRecord(double start, double seconds);
+    FrameRecord* lastFrameRecord();
+    void dumpHitch(const FrameRecord& hitch);
     void createCameraBuffer();
     void initCamera();
-    void updateCamera(float dt);
+    InputSample sampleCameraInput(float dt);
+    void applyCameraInput(const InputSample& input);
+    void startInputRecording();
+    void recordInput(const InputSample& input);
+    void loadReplay();
+    void stepReplay();
+    bool advanceReplay(double elapsed);
+    void replayHeadless();
+    void writeTrajectoryPose();
     void updateCameraBuffer();
+    CameraSnapshot cameraSnapshot(double inputTime) const;
+    void trackCameraMotion(double now);
+    void publishCameraSnapshot(double now);
+    CameraSnapshot predictCamera(const CameraSnapshot& camera) const;
+    static CameraSnapshot poseCamera(const CameraPose& pose);
+    std::vector<RenderView> buildViews(const CameraSnapshot& main) const;
+    static RenderView tileView(const CameraSnapshot& camera, VkRect2D tile, VkExtent2D image);
+    void createHeightCacheSetLayout();
+    void createHeightCachePipeline();
+    void createHeightCache();
+    void destroyHeightCache();
+    void createHeightCacheBuffer(uint32_t levels);
+    void destroyHeightCacheBuffer();
+    void writeHeightCacheDescriptors();
+    void resizeHeightCache(uint32_t levels);
+    void createRenderStatsBuffer();
+    void destroyRenderStatsBuffer();
+    void collectRenderStats();
+    void writeRenderStats();
+    void createCostMapBuffer();
+    void destroyCostMapBuffer();
+    void collectCostMap();
+    void writeCostHeatmap();
+    void createStructureAtlas();
+    void destroyStructureAtlas();
+    uint32_t heightCacheLevelsWithinBudget();
+    void updateMemoryBudget(double now);
+    void logMemoryUsage();
+    void recordHeightCacheUpdate(VkCommandBuffer cmd, uint32_t slot, int32_t centerX, int32_t centerZ);
+    void scheduleHeightCacheUpdate();
+    void submitHeightCacheUpdate();
+    void createTimestampQueries();
+    void collectGpuTimings();
+    void registerMetrics();
+    void updateMemoryMetrics();
+    void calibrateGpuClock();
+    uint64_t gpuToTraceNs(uint64_t ticks, uint64_t mask) const;
+    VkPipelineCreateFlags pipelineCaptureFlags() const;
+    void capturePipelineStatistics(VkPipeline pipeline, const char* name);
+    void writePipelineReport();
+    void createCaptureRing();
+    void destroyCaptureRing();
+    void addCapturePass(GraphResource target);
+    void collectCaptures();
+    void finishCapture();
+    void renderScreenshot();
+    void renderBatch();
+    void serveRequests();
+    void renderOffscreenFrame();
+    void waitForCaptureSlot();
+    void createHistoryImage();
+    void destroyHistoryImage();
+    bool refinementConverged();
+    void updateRefinement(const CameraSnapshot& previous);
+    void initTemporal();
+    bool historyWritten() const;
+    void advanceHistory();
+    void createFarField();
+    void destroyFarField();
+    void recordFarFieldUpdate(VkCommandBuffer cmd, uint32_t imageIndex);
+    void advanceFarField();
+    void updateBenchmarkCamera(double elapsed);
+    void writeBenchmarkReport();
+    void runKernelBenchmark();
+    void timeStartupStep(const char* name, const std::function<void()>& step);
+    void noteFirstFramePresented();
+    void logStartupTimings();
 
 private:
     GLFWwindow* window{};
@@ -106,13 +398,34 @@ private:
     VkDevice device{};
     VkQueue graphicsQueue{};
     VkQueue presentQueue{};
+    VkQueue computeQueue{};
+    uint32_t graphicsQueueFamily{};
+    uint32_t computeQueueFamily{};
+    std::unordered_map<VkPhysicalDevice, QueueFamilyIndices> queueFamilyCache;
+    std::unordered_map<VkPhysicalDevice, std::vector<VkExtensionProperties>> deviceExtensionCache;
+    std::unordered_map<VkPhysicalDevice, SwapchainSupportDetails> swapchainSupportCache;
+    bool timelineSemaphoreSupported{};
+    bool asyncComputeEnabled{};
     VkSwapchainKHR swapchain{};
+    std::string presentModeLabel;
+    PFN_vkWaitForPresentKHR waitForPresent{};
+    uint64_t presentIdValue{};
+    double frameInputTime{};
+    double frameReadTime{};
+    double nextFrameTime{};
+    double latencyPendingInput = -1.0;
+    double latencyPendingRead = -1.0;
+    double displayDelay{};
+    double latencyAccumMs{};
+    uint32_t latencyFrames{};
     std::vector<VkImage> swapchainImages;
     VkFormat swapchainImageFormat{};
     VkExtent2D swapchainExtent{};
     std::vector<VkImageView> swapchainImageViews;
+    VkDeviceMemory offscreenMemory{};
     VkPipelineLayout computePipelineLayout{};
     VkPipeline computePipeline{};
+    VkPipeline farFieldPipeline{};
     VkDescriptorSetLayout computeDescriptorSetLayout{};
     VkDescriptorPool computeDescriptorPool{};
     std::vector<VkDescriptorSet> computeDescriptorSets;
@@ -121,6 +434,111 @@ private:
     VkSemaphore imageAvailableSemaphore{};
     VkSemaphore renderFinishedSemaphore{};
     VkFence inFlightFence{};
+    VkCommandPool computeCommandPool{};
+    VkCommandBuffer computeCommandBuffer{};
+    VkSemaphore computeTimeline{};
+    uint64_t computeTimelineValue{};
+    RenderGraph frameGraph;
+
+    VkBuffer heightCacheBuffer{};
+    VkDeviceMemory heightCacheMemory{};
+    VkBuffer renderStatsBuffer{};
+    VkDeviceMemory renderStatsMemory{};
+    uint32_t* renderStatsMapped{};
+    RenderStats renderStats{};
+    VkBuffer costMapBuffer{};
+    VkDeviceMemory costMapMemory{};
+    uint32_t* costMapMapped{};
+    bool costHeatmapEnabled{};
+    CostHeatmap costHeatmap;
+    VkBuffer structureAtlasBuffer{};
+    VkDeviceMemory structureAtlasMemory{};
+    VkDescriptorSetLayout heightCacheSetLayout{};
+    VkDescriptorPool heightCacheDescriptorPool{};
+    VkDescriptorSet heightCacheDescriptorSet{};
+    VkPipelineLayout heightCachePipelineLayout{};
+    VkPipeline heightCachePipeline{};
+    int32_t heightCacheActiveSlot = -1;
+    int32_t heightCacheCenter[2]{};
+    int32_t heightCachePendingSlot = -1;
+    int32_t heightCachePendingCenter[2]{};
+    uint64_t heightCachePendingValue{};
+    uint64_t heightCacheReadyValue{};
+    int32_t heightCacheUpdateSlot = -1;
+    int32_t heightCacheUpdateCenter[2]{};
+    uint32_t heightCacheLevels{};
+    double heightCacheResizeTime{};
+
+    DeviceMemoryTracker memoryTracker;
+
+    VkQueryPool timestampPool{};
+    float timestampPeriod{};
+    uint64_t graphicsTimestampMask{};
+    uint64_t computeTimestampMask{};
+    bool raymarchQueriesWritten{};
+    bool heightCacheQueriesWritten{};
+    bool heightCacheQueriesAsync{};
+    uint64_t raymarchHistory[8][2]{}; // recent raymarch ranges on the trace clock
+    uint32_t raymarchHistoryCount{};
+    GpuTimings gpuTimings{};
+    RenderMetrics metrics{};
+    FrameRecord currentFrame{};
+    std::vector<FrameRecord> frameRing;
+    uint64_t framesRecorded{};
+    int64_t pendingHitch = -1;
+    double lastHitchDump = -1e9;
+    std::future<void> hitchDumpTask;
+    MetricsServer metricsServer;
+    bool calibratedTimestampsEnabled{};
+    PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps{};
+    VkTimeDomainEXT hostTimeDomain{};
+    uint64_t gpuCalibrationTicks{};
+    uint64_t hostCalibrationNs{};
+    uint64_t lastCalibrationNs{};
+
+    bool pipelineExecutableInfoEnabled{};
+    std::vector<PipelineReport> pipelineReports;
+    std::mutex pipelineReportMutex;
+
+    std::chrono::steady_clock::time_point startupBegin;
+    std::future<void> instanceTask;
+    std::mutex startupMutex;
+    std::vector<StartupStep> startupSteps;
+    double initMs{};
+    double firstFrameMs{};
+
+    bool captureSupported{};
+    std::vector<CaptureSlot> captureSlots;
+    FrameEncoder frameEncoder;
+    uint64_t captureFrameIndex{};
+    uint64_t captureDropped{};
+    bool captureRequested = true;
+    std::vector<RenderView> offscreenViews;
+
+    VkImage historyImage{};
+    VkDeviceMemory historyMemory{};
+    VkImageView historyView{};
+    bool historyLayoutInitialized{};
+    uint32_t refineSamples{};
+    uint32_t refineFrame{};
+    TemporalMode temporalMode = TEMPORAL_OFF;
+    uint32_t traceBlock{};
+    uint32_t historyLayer{};
+    bool historyValid{};
+    std::vector<RenderView> renderViews;
+    std::vector<RenderView> historyViews;
+
+    VkImage farImage{};
+    VkDeviceMemory farMemory{};
+    VkImageView farView{};
+    VkExtent2D farExtent{};
+    bool farLayoutInitialized{};
+    uint32_t farLayer{};
+    bool farValid{};
+
+    double benchmarkStart{};
+    std::atomic<bool> benchmarkRecording{false};
+    BenchmarkStats benchmarkStats;
 
     VkBuffer cameraBuffer{};
     VkDeviceMemory cameraBufferMemory{};
@@ -130,20 +548,80 @@ private:
     Vec3 cameraForward{};
     Vec3 cameraRight{};
     Vec3 cameraUp{};
+    TripleBuffer<CameraSnapshot> cameraSnapshots;
+    CameraSnapshot renderCamera{};
     float cameraYaw{};
     float cameraPitch{};
+    std::deque<CameraMotionSample> cameraMotion;
+    Vec3 cameraVelocity{};
+    float cameraYawRate{};
+    float cameraPitchRate{};
     bool firstMouse{};
     double lastMouseX{};
     double lastMouseY{};
+    InputRecorder inputRecorder;
+    std::vector<InputSample> replaySamples;
+    size_t replayNext{};
+    double replayClock{};
+    std::ofstream trajectoryOut;
+    std::atomic<uint32_t> framesDrawn{0};
+    uint32_t framesSampled{};
 
     std::vector<bool> imageLayoutInitialized;
 
     const uint32_t WIDTH = 1280;
     const uint32_t HEIGHT = 720;
     const uint32_t RAYMARCH_UPSCALE = 2;
+    const uint32_t INTERLEAVED16_BLOCK = 4;
+    const uint32_t FAR_FIELD_BLOCK = 2;
+    const uint32_t HEIGHT_CACHE_RES = 512;
+    const uint32_t HEIGHT_CACHE_MAX_LEVELS = 4;
+    const uint32_t HEIGHT_CACHE_SLOTS = 2;
+    const uint32_t RENDER_STATS_COUNTERS = 4 + 16;
+    const uint32_t COST_MAP_HEADER_WORDS = 4;
+    const uint32_t COST_TILE = 32;
+    const uint32_t STRUCTURE_MAX_HEIGHT = 48;
+    const uint32_t STRUCTURE_MAX_FOOTPRINT = 48;
+    const int32_t HEIGHT_CACHE_SNAP = 64;
+    const double BENCHMARK_WARMUP_SECONDS = 1.0;
+    const uint32_t KERNEL_BENCH_GRID = 1024;
+    const uint32_t KERNEL_BENCH_ITERATIONS = 64;
+    const uint32_t KERNEL_BENCH_REPEATS = 5;
+    const int32_t KERNEL_BENCH_LOD = 2;
+    const double HEIGHT_CACHE_GROW_DELAY = 5.0;
+    const uint32_t CAPTURE_RING_SIZE = 3;
+    const uint32_t CAPTURE_FPS = 60;
+    const uint64_t PRESENT_WAIT_TIMEOUT_NS = 100000000;
+    const double FRAME_LIMIT_SPIN_SECONDS = 0.002;
+    const double INPUT_POLL_SECONDS = 0.001;
+    const uint32_t REFINE_MAX_SAMPLES = 64;
+    const double CAPTURE_SLOT_POLL_SECONDS = 0.001;
+    const size_t FLIGHT_RECORDER_FRAMES = 2048;
+    const double FLIGHT_RECORDER_SECONDS = 5.0;
+    const double HITCH_DUMP_COOLDOWN_SECONDS = 5.0;
+    const uint64_t CLOCK_CALIBRATION_NS = 1000000000;
+    const double CAMERA_MOTION_WINDOW_SECONDS = 0.05;
+    const double MAX_PREDICTION_SECONDS = 0.1;
+    const double DISPLAY_DELAY_SMOOTHING = 0.1;
+    const float CAMERA_PITCH_LIMIT = 1.55334f;
+    const double SERVER_POLL_SECONDS = 0.1;
+    const double SERVER_REPORT_SECONDS = 10.0;
+    AppOptions options;
     bool validationEnabled{};
     bool cursorLocked{};
     double fpsTimeAccum{};
     int fpsFrameCount{};
+
+    std::thread renderThread;
+    std::atomic<bool> renderStop{false};
+    std::exception_ptr renderError;
+    // Set while the render thread sleeps on a converged image; it waits on
+    // snapshotPublished, which every new camera snapshot (and stopping) signals.
+    std::atomic<bool> renderConverged{false};
+    std::mutex snapshotMutex;
+    std::condition_variable snapshotPublished;
+    std::mutex titleMutex;
+    std::string windowTitle;
+    std::atomic<bool> titleDirty{false};
 };
 
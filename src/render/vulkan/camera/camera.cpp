@@ -3,6 +3,7 @@
 #include <cstring>
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
 
 void VulkanAppImpl::createCameraBuffer() {
     VkBufferCreateInfo info{};
@@ -11,7 +12,7 @@ void VulkanAppImpl::createCameraBuffer() {
     info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
     info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateBuffer(device, &info, nullptr, &cameraBuffer) != VK_SUCCESS) {
+    if (vkCreateBuffer(device, &info, gVkAllocator, &cameraBuffer) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create camera buffer");
     }
 
@@ -24,7 +25,7 @@ void VulkanAppImpl::createCameraBuffer() {
     alloc.memoryTypeIndex = findMemoryType(req.memoryTypeBits,
                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-    if (vkAllocateMemory(device, &alloc, nullptr, &cameraBufferMemory) != VK_SUCCESS) {
+    if (memoryTracker.allocate(alloc, &cameraBufferMemory) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate camera buffer memory");
     }
 
@@ -44,40 +45,26 @@ void VulkanAppImpl::initCamera() {
     cameraRight = vnorm(vcross(cameraForward, up));
     cameraUp = vcross(cameraRight, cameraForward);
 
+    // The aspect ratio comes from each view's viewport.
     float fov = 1.0471976f;
-    float aspect = static_cast<float>(swapchainExtent.width) / static_cast<float>(swapchainExtent.height);
     float sliceY = 0.0f;
 
-    cameraData.camPos[0] = cameraPos.x;
-    cameraData.camPos[1] = cameraPos.y;
-    cameraData.camPos[2] = cameraPos.z;
-    cameraData.camPos[3] = 1.0f;
-
-    cameraData.camForward[0] = cameraForward.x;
-    cameraData.camForward[1] = cameraForward.y;
-    cameraData.camForward[2] = cameraForward.z;
-    cameraData.camForward[3] = 0.0f;
-
-    cameraData.camRight[0] = cameraRight.x;
-    cameraData.camRight[1] = cameraRight.y;
-    cameraData.camRight[2] = cameraRight.z;
-    cameraData.camRight[3] = 0.0f;
-
-    cameraData.camUp[0] = cameraUp.x;
-    cameraData.camUp[1] = cameraUp.y;
-    cameraData.camUp[2] = cameraUp.z;
-    cameraData.camUp[3] = 0.0f;
-
     cameraData.params[0] = fov;
-    cameraData.params[1] = aspect;
+    cameraData.params[1] = static_cast<float>(options.structureDensity);
     cameraData.params[2] = sliceY;
-    cameraData.params[3] = 0.0f;
+    cameraData.params[3] = static_cast<float>(options.microDistance);
 
+    renderCamera = cameraSnapshot(0.0);
+    renderViews = buildViews(renderCamera);
+    historyViews = renderViews;
     updateCameraBuffer();
 }
 
-void VulkanAppImpl::updateCamera(float dt) {
-    if (dt <= 0.0f) dt = 0.016f;
+// The camera only moves through applyCameraInput, and live input is reduced
+// to the same InputSample a recording stores, so a replay retraces it exactly.
+InputSample VulkanAppImpl::sampleCameraInput(float dt) {
+    InputSample input;
+    input.dt = dt > 0.0f ? dt : 0.016f;
 
     double x, y;
     glfwGetCursorPos(window, &x, &y);
@@ -86,17 +73,31 @@ void VulkanAppImpl::updateCamera(float dt) {
         lastMouseY = y;
         firstMouse = false;
     }
-    double dx = x - lastMouseX;
-    double dy = y - lastMouseY;
+    input.mouseDx = static_cast<float>(x - lastMouseX);
+    input.mouseDy = static_cast<float>(y - lastMouseY);
     lastMouseX = x;
     lastMouseY = y;
 
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) input.keys |= INPUT_FORWARD;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) input.keys |= INPUT_BACK;
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) input.keys |= INPUT_LEFT;
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) input.keys |= INPUT_RIGHT;
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) input.keys |= INPUT_UP;
+    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ||
+        glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS) {
+        input.keys |= INPUT_DOWN;
+    }
+    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) input.keys |= INPUT_FAST;
+    return input;
+}
+
+void VulkanAppImpl::applyCameraInput(const InputSample& input) {
+    PROFILE_ZONE("updateCamera");
     float sensitivity = 0.002f;
-    cameraYaw -= static_cast<float>(dx) * sensitivity;
-    cameraPitch -= static_cast<float>(dy) * sensitivity;
-    const float limit = 1.55334f;
-    if (cameraPitch > limit) cameraPitch = limit;
-    if (cameraPitch < -limit) cameraPitch = -limit;
+    cameraYaw -= input.mouseDx * sensitivity;
+    cameraPitch -= input.mouseDy * sensitivity;
+    if (cameraPitch > CAMERA_PITCH_LIMIT) cameraPitch = CAMERA_PITCH_LIMIT;
+    if (cameraPitch < -CAMERA_PITCH_LIMIT) cameraPitch = -CAMERA_PITCH_LIMIT;
 
     cameraForward = vnorm({std::cos(cameraPitch) * std::cos(cameraYaw),
                            std::sin(cameraPitch),
@@ -106,30 +107,29 @@ void VulkanAppImpl::updateCamera(float dt) {
     cameraUp = vcross(cameraRight, cameraForward);
 
     float speed = 20.0f;
-    if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) {
+    if (input.keys & INPUT_FAST) {
         speed *= 20.0f;
     }
-    float vel = speed * dt;
+    float vel = speed * input.dt;
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    if (input.keys & INPUT_FORWARD) {
         cameraPos = vadd(cameraPos, vscale(cameraForward, vel));
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    if (input.keys & INPUT_BACK) {
         cameraPos = vsub(cameraPos, vscale(cameraForward, vel));
     }
     Vec3 flatRight = {cameraRight.x, 0.0f, cameraRight.z};
     flatRight = vnorm(flatRight);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    if (input.keys & INPUT_RIGHT) {
         cameraPos = vsub(cameraPos, vscale(flatRight, vel));
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    if (input.keys & INPUT_LEFT) {
         cameraPos = vadd(cameraPos, vscale(flatRight, vel));
     }
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+    if (input.keys & INPUT_UP) {
         cameraPos.y += vel;
     }
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ||
-        glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS) {
+    if (input.keys & INPUT_DOWN) {
         cameraPos.y -= vel;
     }
 
@@ -140,25 +140,122 @@ void VulkanAppImpl::updateCamera(float dt) {
     }
 }
 
+CameraSnapshot VulkanAppImpl::cameraSnapshot(double inputTime) const {
+    CameraSnapshot snapshot;
+    snapshot.pos = cameraPos;
+    snapshot.forward = cameraForward;
+    snapshot.right = cameraRight;
+    snapshot.up = cameraUp;
+    snapshot.inputTime = inputTime;
+    snapshot.yaw = cameraYaw;
+    snapshot.pitch = cameraPitch;
+    snapshot.velocity = cameraVelocity;
+    snapshot.yawRate = cameraYawRate;
+    snapshot.pitchRate = cameraPitchRate;
+    return snapshot;
+}
+
+// Velocity and turn rates are averaged over a short window: mouse deltas
+// arrive in bursts, and over a window the rates drop to exactly zero once the
+// camera stops, so a still camera is never predicted to move.
+void VulkanAppImpl::trackCameraMotion(double now) {
+    cameraMotion.push_back({ now, cameraPos, cameraYaw, cameraPitch });
+    while (cameraMotion.size() > 1 && now - cameraMotion[1].time >= CAMERA_MOTION_WINDOW_SECONDS) cameraMotion.pop_front();
+
+    const CameraMotionSample& oldest = cameraMotion.front();
+    double span = now - oldest.time;
+    if (span <= 0.0) {
+        cameraVelocity = {};
+        cameraYawRate = 0.0f;
+        cameraPitchRate = 0.0f;
+        return;
+    }
+    float inv = static_cast<float>(1.0 / span);
+    cameraVelocity = vscale(vsub(cameraPos, oldest.pos), inv);
+    cameraYawRate = (cameraYaw - oldest.yaw) * inv;
+    cameraPitchRate = (cameraPitch - oldest.pitch) * inv;
+}
+
+// Extrapolates the camera to when the frame is expected on screen: the
+// snapshot's age when the render thread picked it up plus the measured delay
+// from then to display. Views built from the prediction become the next
+// frame's history, so reprojection always pairs two predictions.
+CameraSnapshot VulkanAppImpl::predictCamera(const CameraSnapshot& camera) const {
+    bool moving = camera.velocity.x != 0.0f || camera.velocity.y != 0.0f || camera.velocity.z != 0.0f ||
+                  camera.yawRate != 0.0f || camera.pitchRate != 0.0f;
+    if (!options.cameraPrediction || headless() || !moving) return camera;
+
+    float t = static_cast<float>(std::clamp(frameReadTime - camera.inputTime + displayDelay, 0.0, MAX_PREDICTION_SECONDS));
+    Vec3 pos = vadd(camera.pos, vscale(camera.velocity, t));
+    float pitch = std::clamp(camera.pitch + camera.pitchRate * t, -CAMERA_PITCH_LIMIT, CAMERA_PITCH_LIMIT);
+    CameraSnapshot predicted = poseCamera({ pos.x, pos.y, pos.z, camera.yaw + camera.yawRate * t, pitch });
+    predicted.inputTime = camera.inputTime;
+    return predicted;
+}
+
+// A still camera at a pose from a camera list or a render request.
+CameraSnapshot VulkanAppImpl::poseCamera(const CameraPose& pose) {
+    CameraSnapshot camera;
+    camera.pos = { pose.x, pose.y, pose.z };
+    camera.forward = vnorm({ std::cos(pose.pitch) * std::cos(pose.yaw),
+                             std::sin(pose.pitch),
+                             std::cos(pose.pitch) * std::sin(pose.yaw) });
+    Vec3 up = { 0.0f, 1.0f, 0.0f };
+    camera.right = vnorm(vcross(camera.forward, up));
+    camera.up = vcross(camera.right, camera.forward);
+    return camera;
+}
+
+static void copyVec3(float* dst, Vec3 v) {
+    dst[0] = v.x;
+    dst[1] = v.y;
+    dst[2] = v.z;
+}
+
+// Runs on the render thread and only reads renderCamera; cameraPos and friends
+// belong to the input thread.
 void VulkanAppImpl::updateCameraBuffer() {
-    cameraData.camPos[0] = cameraPos.x;
-    cameraData.camPos[1] = cameraPos.y;
-    cameraData.camPos[2] = cameraPos.z;
+    PROFILE_ZONE("updateCameraBuffer");
+    renderViews = buildViews(predictCamera(renderCamera));
+    cameraData.viewCount[0] = static_cast<int32_t>(renderViews.size());
+    for (size_t i = 0; i < renderViews.size(); i++) {
+        const RenderView& current = renderViews[i];
+        const RenderView& previous = i < historyViews.size() ? historyViews[i] : current;
+        ViewUBO& view = cameraData.views[i];
+        copyVec3(view.pos, current.camera.pos);
+        copyVec3(view.forward, current.camera.forward);
+        copyVec3(view.right, current.camera.right);
+        copyVec3(view.up, current.camera.up);
+        copyVec3(view.prevPos, previous.camera.pos);
+        copyVec3(view.prevForward, previous.camera.forward);
+        copyVec3(view.prevRight, previous.camera.right);
+        copyVec3(view.prevUp, previous.camera.up);
+        view.viewport[0] = current.viewport.offset.x;
+        view.viewport[1] = current.viewport.offset.y;
+        view.viewport[2] = static_cast<int32_t>(current.viewport.extent.width);
+        view.viewport[3] = static_cast<int32_t>(current.viewport.extent.height);
+        std::memcpy(view.window, current.window, sizeof(view.window));
+    }
 
-    cameraData.camForward[0] = cameraForward.x;
-    cameraData.camForward[1] = cameraForward.y;
-    cameraData.camForward[2] = cameraForward.z;
+    cameraData.heightCache[0] = heightCacheCenter[0];
+    cameraData.heightCache[1] = heightCacheCenter[1];
+    cameraData.heightCache[2] = heightCacheActiveSlot < 0 ? 0 : heightCacheActiveSlot;
+    cameraData.heightCache[3] = heightCacheActiveSlot < 0 ? 0 : static_cast<int32_t>(heightCacheLevels);
 
-    cameraData.camRight[0] = cameraRight.x;
-    cameraData.camRight[1] = cameraRight.y;
-    cameraData.camRight[2] = cameraRight.z;
+    cameraData.refine[0] = static_cast<int32_t>(refineSamples);
+    cameraData.refine[1] = static_cast<int32_t>(refineFrame);
 
-    cameraData.camUp[0] = cameraUp.x;
-    cameraData.camUp[1] = cameraUp.y;
-    cameraData.camUp[2] = cameraUp.z;
+    cameraData.temporal[0] = temporalMode;
+    cameraData.temporal[1] = static_cast<int32_t>(historyLayer);
+    cameraData.temporal[2] = historyValid ? 1 : 0;
+    cameraData.temporal[3] = static_cast<int32_t>(traceBlock);
 
-    float aspect = static_cast<float>(swapchainExtent.width) / static_cast<float>(swapchainExtent.height);
-    cameraData.params[1] = aspect;
+    bool farEnabled = options.farDistance > 0.0;
+    cameraData.farField[0] = farEnabled ? static_cast<float>(options.nearDistance) : 0.0f;
+    cameraData.farField[1] = static_cast<float>(options.farDistance);
+    cameraData.farState[0] = static_cast<int32_t>(farLayer);
+    cameraData.farState[1] = farValid ? 1 : 0;
+    cameraData.farState[2] = static_cast<int32_t>(std::lround(16 * 16 * options.farUpdateFraction));
 
     void* data = nullptr;
     vkMapMemory(device, cameraBufferMemory, 0, sizeof(CameraUBO), 0, &data);
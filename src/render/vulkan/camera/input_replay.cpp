@@ -0,0 +1,150 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+// --record-input stores every input poll as an InputSample: the time step,
+// mouse movement, held keys and the frames drawn since the poll before. A
+// replay feeds the samples to applyCameraInput in the same order, so the
+// camera passes through the same poses bit for bit. In the window the samples
+// are applied as their time steps come due and the render thread draws as it
+// would live; headless, each sample's recorded frames are rendered back to
+// back, which turns a recorded slow spot into a repeatable benchmark.
+// --replay-dt replaces the recorded steps, and headless renders one frame per
+// sample.
+
+void VulkanAppImpl::startInputRecording() {
+    CameraPose start{ cameraPos.x, cameraPos.y, cameraPos.z, cameraYaw, cameraPitch };
+    if (!inputRecorder.start(options.recordInput, start)) {
+        throw std::runtime_error("Failed to open input recording " + options.recordInput);
+    }
+    framesSampled = framesDrawn.load(std::memory_order_relaxed);
+    writeTrajectoryPose();
+}
+
+void VulkanAppImpl::recordInput(const InputSample& input) {
+    if (!inputRecorder.active()) return;
+    InputSample sample = input;
+    uint32_t drawn = framesDrawn.load(std::memory_order_relaxed);
+    sample.frames = static_cast<uint16_t>(std::min<uint32_t>(drawn - framesSampled, UINT16_MAX));
+    framesSampled = drawn;
+    inputRecorder.write(sample);
+    writeTrajectoryPose();
+}
+
+void VulkanAppImpl::loadReplay() {
+    CameraPose start;
+    replaySamples.clear();
+    if (!loadInputRecording(options.replayInput, start, replaySamples)) {
+        throw std::runtime_error("Failed to read input recording " + options.replayInput);
+    }
+    CameraSnapshot pose = poseCamera(start);
+    cameraPos = pose.pos;
+    cameraYaw = start.yaw;
+    cameraPitch = start.pitch;
+    cameraForward = pose.forward;
+    cameraRight = pose.right;
+    cameraUp = pose.up;
+    replayNext = 0;
+    replayClock = 0.0;
+    writeTrajectoryPose();
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        gLogFile << "replay: " << replaySamples.size() << " input samples from " << options.replayInput << '\n';
+        gLogFile.flush();
+    }
+}
+
+void VulkanAppImpl::stepReplay() {
+    InputSample input = replaySamples[replayNext++];
+    if (options.replayDt > 0.0) input.dt = static_cast<float>(options.replayDt);
+    applyCameraInput(input);
+    replayClock += input.dt;
+    writeTrajectoryPose();
+}
+
+// Applies every sample due by `elapsed`; false once the recording is used up.
+bool VulkanAppImpl::advanceReplay(double elapsed) {
+    while (replayNext < replaySamples.size() && replayClock <= elapsed) stepReplay();
+    return replayNext < replaySamples.size();
+}
+
+void VulkanAppImpl::replayHeadless() {
+    loadReplay();
+    bool fixedStep = options.replayDt > 0.0;
+
+    // One full-size view of the player camera; history and the far layer
+    // carry over between frames exactly as in the window.
+    renderCamera = cameraSnapshot(replayClock);
+    offscreenViews = { tileView(renderCamera, { { 0, 0 }, swapchainExtent }, swapchainExtent) };
+    renderViews = offscreenViews;
+    historyViews = renderViews;
+    historyValid = false;
+    farValid = false;
+    captureRequested = false;
+    benchmarkRecording = options.benchmark;
+
+    std::vector<double> frameMs;
+    uint32_t rendered = 0;
+    auto begin = std::chrono::steady_clock::now();
+    auto last = begin;
+    while (replayNext < replaySamples.size()) {
+        uint32_t frames = fixedStep ? 1 : replaySamples[replayNext].frames;
+        for (uint32_t f = 0; f < frames; f++) {
+            renderCamera = cameraSnapshot(replayClock);
+            offscreenViews = { tileView(renderCamera, { { 0, 0 }, swapchainExtent }, swapchainExtent) };
+            renderOffscreenFrame();
+
+            // Each frame waits for the one before, so the spacing of the
+            // submits is the GPU frame time. The first includes warm-up.
+            auto now = std::chrono::steady_clock::now();
+            if (rendered++ > 0) {
+                double ms = std::chrono::duration<double, std::milli>(now - last).count();
+                frameMs.push_back(ms);
+                if (benchmarkRecording) benchmarkStats.frameMs.push_back(ms);
+            }
+            last = now;
+        }
+        stepReplay();
+    }
+    vkDeviceWaitIdle(device);
+    captureRequested = true;
+    if (options.benchmark) {
+        collectGpuTimings();
+        writeBenchmarkReport();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::sort(frameMs.begin(), frameMs.end());
+    double sum = 0.0;
+    for (double ms : frameMs) sum += ms;
+    double avg = frameMs.empty() ? 0.0 : sum / static_cast<double>(frameMs.size());
+    double p95 = frameMs.empty() ? 0.0 : frameMs[static_cast<size_t>(0.95 * static_cast<double>(frameMs.size() - 1) + 0.5)];
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "replay: %zu samples, %u frames of %ux%u in %.2f s, frame %.2f ms avg, %.2f ms p95, %s time steps\n",
+                      replaySamples.size(), rendered, swapchainExtent.width, swapchainExtent.height, seconds, avg, p95, fixedStep ? "fixed" : "recorded");
+        gLogFile << line;
+        gLogFile.flush();
+    }
+}
+
+// One camera list line per pose; %.9g round-trips a float, so two runs with
+// the same poses write the same file.
+void VulkanAppImpl::writeTrajectoryPose() {
+    if (options.trajectoryOutput.empty()) return;
+    if (!trajectoryOut.is_open()) {
+        trajectoryOut.open(options.trajectoryOutput, std::ios::out | std::ios::trunc);
+        if (!trajectoryOut.is_open()) return;
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line), "%.9g %.9g %.9g %.9g %.9g\n", cameraPos.x, cameraPos.y, cameraPos.z, cameraYaw,
+                  cameraPitch);
+    trajectoryOut << line;
+}
@@ -0,0 +1,91 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+// Every layout derives its extra views from the player camera, so the input
+// thread still publishes a single snapshot. Later views are drawn over
+// earlier ones.
+
+static Vec3 rotateYaw(Vec3 v, float angle) {
+    float c = std::cos(angle);
+    float s = std::sin(angle);
+    return { c * v.x - s * v.z, v.y, s * v.x + c * v.z };
+}
+
+static CameraSnapshot orientedCamera(const CameraSnapshot& main, Vec3 pos, Vec3 forward, Vec3 up) {
+    CameraSnapshot view = main;
+    view.pos = pos;
+    view.forward = vnorm(forward);
+    view.right = vnorm(vcross(view.forward, up));
+    view.up = vcross(view.right, view.forward);
+    return view;
+}
+
+std::vector<RenderView> VulkanAppImpl::buildViews(const CameraSnapshot& main) const {
+    const float MINIMAP_HEIGHT = 200.0f;
+    const int32_t INSET_MARGIN = 16;
+    uint32_t width = swapchainExtent.width;
+    uint32_t height = swapchainExtent.height;
+
+    // Headless runs choose their views per frame (tiles, batch cameras,
+    // server requests) and have no player camera.
+    if (headless()) return offscreenViews;
+
+    std::vector<RenderView> views;
+    if (options.viewLayout == "quad") {
+        // Four horizontal directions a quarter turn apart.
+        uint32_t halfWidth = width / 2;
+        uint32_t halfHeight = height / 2;
+        for (uint32_t i = 0; i < 4; i++) {
+            float angle = 1.5707963f * static_cast<float>(i);
+            RenderView view;
+            view.camera = orientedCamera(main, main.pos, rotateYaw(main.forward, angle), { 0.0f, 1.0f, 0.0f });
+            view.viewport.offset = { static_cast<int32_t>((i % 2) * halfWidth), static_cast<int32_t>((i / 2) * halfHeight) };
+            view.viewport.extent = { halfWidth, halfHeight };
+            views.push_back(view);
+        }
+        return views;
+    }
+
+    RenderView player;
+    player.camera = main;
+    player.viewport.extent = { width, height };
+    views.push_back(player);
+
+    if (options.viewLayout == "mirror") {
+        RenderView mirror;
+        mirror.camera = main;
+        mirror.camera.forward = vscale(main.forward, -1.0f);
+        mirror.camera.right = vscale(main.right, -1.0f);
+        mirror.viewport.extent = { width / 3, height / 5 };
+        mirror.viewport.offset = { static_cast<int32_t>((width - width / 3) / 2), INSET_MARGIN };
+        views.push_back(mirror);
+    } else if (options.viewLayout == "minimap") {
+        Vec3 flatForward = vnorm({ main.forward.x, 0.0f, main.forward.z });
+        if (vlen(flatForward) <= 0.0f) flatForward = { 0.0f, 0.0f, -1.0f };
+        RenderView minimap;
+        minimap.camera = orientedCamera(main, vadd(main.pos, { 0.0f, MINIMAP_HEIGHT, 0.0f }), { 0.0f, -1.0f, 0.0f }, flatForward);
+        uint32_t size = width / 4;
+        minimap.viewport.extent = { size, size };
+        minimap.viewport.offset = { static_cast<int32_t>(width - size) - INSET_MARGIN, static_cast<int32_t>(height - size) - INSET_MARGIN };
+        views.push_back(minimap);
+    } else if (options.viewLayout != "single") {
+        throw std::runtime_error("Unknown view layout: " + options.viewLayout);
+    }
+    return views;
+}
+
+// `tile` of an `image`-sized render of `camera`, drawn at the target's origin.
+RenderView VulkanAppImpl::tileView(const CameraSnapshot& camera, VkRect2D tile, VkExtent2D image) {
+    float width = static_cast<float>(image.width);
+    float height = static_cast<float>(image.height);
+    RenderView view;
+    view.camera = camera;
+    view.viewport.extent = tile.extent;
+    view.window[0] = static_cast<float>(tile.offset.x) / width;
+    view.window[1] = static_cast<float>(tile.offset.y) / height;
+    view.window[2] = static_cast<float>(tile.extent.width) / width;
+    view.window[3] = static_cast<float>(tile.extent.height) / height;
+    return view;
+}
@@ -0,0 +1,66 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+// One shard of a batch render: every camera of the list whose index is the
+// shard index modulo the shard count is rendered headless as a single-tile
+// still and handed to the frame encoder, which writes the PNGs on its own
+// thread while the GPU renders the next camera.
+
+void VulkanAppImpl::renderBatch() {
+    std::vector<CameraPose> poses;
+    if (!loadCameraList(options.batchCameras, poses)) {
+        throw std::runtime_error("Failed to read camera list " + options.batchCameras);
+    }
+    if (captureSlots.empty()) throw std::runtime_error("Failed to create batch readback buffers");
+    uint32_t shards = std::max(options.batchShards, 1u);
+    uint32_t shard = options.shardIndex > 0 ? static_cast<uint32_t>(options.shardIndex) : 0;
+    uint32_t samples = std::max(options.batchSamples, 1u);
+
+    if (!frameEncoder.start(options.batchOutput, CaptureFormat::Png, swapchainExtent.width, swapchainExtent.height, false, CAPTURE_FPS)) {
+        throw std::runtime_error("Failed to open batch output " + options.batchOutput);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t images = 0;
+    for (size_t i = shard; i < poses.size(); i += shards) {
+        renderCamera = poseCamera(poses[i]);
+        offscreenViews = { tileView(renderCamera, { { 0, 0 }, swapchainExtent }, swapchainExtent) };
+        renderViews = offscreenViews;
+        historyViews = renderViews;
+        historyValid = false;
+        farValid = false;
+
+        for (uint32_t sample = 1; sample <= samples; sample++) {
+            captureRequested = sample == samples;
+            if (captureRequested) {
+                waitForCaptureSlot();
+                captureFrameIndex = i;
+            }
+            refineSamples = sample;
+            renderOffscreenFrame();
+        }
+        images++;
+    }
+    vkDeviceWaitIdle(device);
+    collectCaptures();
+    frameEncoder.stop();
+    captureRequested = true;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        char line[320];
+        std::snprintf(line, sizeof(line),
+                      "batch: shard %u/%u on %s rendered %u images of %ux%u, %u samples, in %.2f s (%.2f images/s) after %.0f ms init\n",
+                      shard, shards, props.deviceName, images, swapchainExtent.width, swapchainExtent.height, samples,
+                      seconds, images / std::max(seconds, 1e-9), initMs);
+        gLogFile << line;
+        gLogFile.flush();
+    }
+}
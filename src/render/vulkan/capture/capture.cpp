@@ -0,0 +1,162 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <stdexcept>
+
+// Frames are copied into a ring of host-visible buffers by a transfer pass at
+// the end of the frame. Once the frame's fence has signalled, the slot is
+// handed to the encoder thread; the slot comes back when the encoder is done
+// with it. If the encoder falls behind and every slot is taken, the frame is
+// dropped from the capture rather than stalling the render loop.
+
+void VulkanAppImpl::createCaptureRing() {
+    if (options.captureOutput.empty() && !headless()) return;
+
+    // Screenshot tiles go to a TileWriter instead of the frame encoder.
+    CaptureFormat format{};
+    if (!headless() && !parseCaptureFormat(options.captureFormat, format)) {
+        throw std::runtime_error("Unknown capture format: " + options.captureFormat);
+    }
+    bool bgra = swapchainImageFormat == VK_FORMAT_B8G8R8A8_SRGB || swapchainImageFormat == VK_FORMAT_B8G8R8A8_UNORM;
+    bool rgba = swapchainImageFormat == VK_FORMAT_R8G8B8A8_SRGB || swapchainImageFormat == VK_FORMAT_R8G8B8A8_UNORM;
+    if (!captureSupported || (!bgra && !rgba)) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) {
+            gLogFile << "capture: swapchain cannot be read back, capture disabled\n";
+            gLogFile.flush();
+        }
+        return;
+    }
+
+    VkDeviceSize size = static_cast<VkDeviceSize>(swapchainExtent.width) * swapchainExtent.height * 4;
+
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    captureSlots = std::vector<CaptureSlot>(CAPTURE_RING_SIZE);
+    for (auto& slot : captureSlots) {
+        VkBufferCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        info.size = size;
+        info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(device, &info, gVkAllocator, &slot.buffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create capture buffer");
+        }
+
+        VkMemoryRequirements req{};
+        vkGetBufferMemoryRequirements(device, slot.buffer, &req);
+
+        // Cached memory makes the encoder's reads an order of magnitude faster
+        // than write-combined memory; fall back to the latter if needed.
+        VkMemoryPropertyFlags required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        uint32_t typeIndex = UINT32_MAX;
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount && typeIndex == UINT32_MAX; i++) {
+            VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+            if ((req.memoryTypeBits & (1u << i)) && (flags & required) == required && (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) {
+                typeIndex = i;
+            }
+        }
+        if (typeIndex == UINT32_MAX) typeIndex = findMemoryType(req.memoryTypeBits, required);
+
+        VkMemoryAllocateInfo alloc{};
+        alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc.allocationSize = req.size;
+        alloc.memoryTypeIndex = typeIndex;
+
+        if (memoryTracker.allocate(alloc, &slot.memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate capture memory");
+        }
+        vkBindBufferMemory(device, slot.buffer, slot.memory, 0);
+
+        void* mapped = nullptr;
+        if (vkMapMemory(device, slot.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map capture memory");
+        }
+        slot.pixels = static_cast<const uint8_t*>(mapped);
+        slot.released = true;
+    }
+
+    captureFrameIndex = 0;
+    captureDropped = 0;
+    if (headless()) return;
+    if (!frameEncoder.start(options.captureOutput, format, swapchainExtent.width, swapchainExtent.height, bgra, CAPTURE_FPS)) {
+        throw std::runtime_error("Failed to open capture output " + options.captureOutput);
+    }
+}
+
+void VulkanAppImpl::destroyCaptureRing() {
+    frameEncoder.stop();
+    for (auto& slot : captureSlots) {
+        vkDestroyBuffer(device, slot.buffer, gVkAllocator);
+        memoryTracker.free(slot.memory);
+    }
+    captureSlots.clear();
+}
+
+void VulkanAppImpl::addCapturePass(GraphResource target) {
+    if (captureSlots.empty() || !captureRequested) return;
+
+    CaptureSlot* free = nullptr;
+    for (auto& slot : captureSlots) {
+        if (!slot.recorded && slot.released.load(std::memory_order_acquire)) {
+            free = &slot;
+            break;
+        }
+    }
+    if (!free) {
+        captureDropped++;
+        metrics.capturesDropped->add();
+        return;
+    }
+    free->released = false;
+    free->recorded = true;
+    free->index = captureFrameIndex++;
+
+    VkDeviceSize size = static_cast<VkDeviceSize>(swapchainExtent.width) * swapchainExtent.height * 4;
+    GraphResource buffer = frameGraph.importBuffer("capture", free->buffer, 0, size);
+    frameGraph.addPass("capture", RenderQueue::Graphics,
+                       { { target, ResourceUsage::TransferRead }, { buffer, ResourceUsage::TransferWrite } },
+                       [this, target, buffer](VkCommandBuffer c) {
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = { swapchainExtent.width, swapchainExtent.height, 1 };
+        vkCmdCopyImageToBuffer(c, frameGraph.image(target), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               frameGraph.buffer(buffer), 1, &region);
+
+        // Host reads after the fence wait still need the writes made visible.
+        VkMemoryBarrier hostBarrier{};
+        hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(c, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0, nullptr);
+    });
+}
+
+void VulkanAppImpl::collectCaptures() {
+    // Must run after inFlightFence is waited: every recorded copy is complete.
+    for (auto& slot : captureSlots) {
+        if (!slot.recorded) continue;
+        slot.recorded = false;
+        frameEncoder.push({ slot.pixels, swapchainExtent.width * 4, slot.index, &slot.released });
+    }
+    uint32_t busy = 0;
+    for (const auto& slot : captureSlots) {
+        if (!slot.released.load(std::memory_order_relaxed)) busy++;
+    }
+    metrics.captureSlotsBusy->set(busy);
+}
+
+void VulkanAppImpl::finishCapture() {
+    if (captureSlots.empty()) return;
+    collectCaptures();
+    frameEncoder.stop();
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        gLogFile << "capture: " << frameEncoder.framesWritten() << " frames written to " << options.captureOutput
+                 << ", " << captureDropped << " dropped\n";
+        gLogFile.flush();
+    }
+}
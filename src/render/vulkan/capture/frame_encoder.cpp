@@ -0,0 +1,377 @@
+#include "render/vulkan/capture/frame_encoder.hpp"
+
+#include "core/logging.hpp"
+#include "core/profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+bool parseCaptureFormat(const std::string& name, CaptureFormat& format) {
+    if (name == "raw") format = CaptureFormat::Raw;
+    else if (name == "y4m") format = CaptureFormat::Y4M;
+    else if (name == "png") format = CaptureFormat::Png;
+    else return false;
+    return true;
+}
+
+bool FrameEncoder::start(const std::string& outputPath, CaptureFormat outputFormat, uint32_t w, uint32_t h, bool isBgra, uint32_t fps) {
+    path = outputPath;
+    format = outputFormat;
+    width = w;
+    height = h;
+    bgra = isBgra;
+    stopping = false;
+    written = 0;
+
+    if (format != CaptureFormat::Png) {
+        out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+    }
+    if (format == CaptureFormat::Y4M) {
+        char header[96];
+        std::snprintf(header, sizeof(header), "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, fps);
+        out << header;
+    }
+
+    worker = std::thread(&FrameEncoder::run, this);
+    return true;
+}
+
+void FrameEncoder::push(const CaptureFrame& frame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(frame);
+    }
+    wake.notify_one();
+}
+
+void FrameEncoder::stop() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    if (out.is_open()) out.close();
+}
+
+void FrameEncoder::run() {
+    setProfilerThreadName("frame encoder");
+    for (;;) {
+        CaptureFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            frame = queue.front();
+            queue.pop_front();
+        }
+        {
+            PROFILE_ZONE("encode frame");
+            writeFrame(frame);
+        }
+        frame.released->store(true, std::memory_order_release);
+        written.fetch_add(1);
+    }
+}
+
+void FrameEncoder::writeFrame(const CaptureFrame& frame) {
+    switch (format) {
+    case CaptureFormat::Raw:
+        scratch.resize(static_cast<size_t>(width) * 4);
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t* src = frame.pixels + static_cast<size_t>(y) * frame.rowPitch;
+            for (uint32_t x = 0; x < width; x++) {
+                scratch[x * 4 + 0] = src[x * 4 + (bgra ? 2 : 0)];
+                scratch[x * 4 + 1] = src[x * 4 + 1];
+                scratch[x * 4 + 2] = src[x * 4 + (bgra ? 0 : 2)];
+                scratch[x * 4 + 3] = 255;
+            }
+            out.write(reinterpret_cast<const char*>(scratch.data()), static_cast<std::streamsize>(scratch.size()));
+        }
+        break;
+    case CaptureFormat::Y4M:
+        writeY4m(frame);
+        break;
+    case CaptureFormat::Png:
+        writePng(frame);
+        break;
+    }
+}
+
+void FrameEncoder::writeY4m(const CaptureFrame& frame) {
+    uint32_t chromaWidth = (width + 1) / 2;
+    uint32_t chromaHeight = (height + 1) / 2;
+    size_t lumaSize = static_cast<size_t>(width) * height;
+    size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+    scratch.assign(lumaSize + 2 * chromaSize, 0);
+    uint8_t* yPlane = scratch.data();
+    uint8_t* uPlane = yPlane + lumaSize;
+    uint8_t* vPlane = uPlane + chromaSize;
+
+    int ri = bgra ? 2 : 0;
+    int bi = bgra ? 0 : 2;
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* src = frame.pixels + static_cast<size_t>(y) * frame.rowPitch;
+        for (uint32_t x = 0; x < width; x++) {
+            int r = src[x * 4 + ri], g = src[x * 4 + 1], b = src[x * 4 + bi];
+            yPlane[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+
+    // Chroma is the average of each 2x2 block (edge pixels repeated).
+    for (uint32_t cy = 0; cy < chromaHeight; cy++) {
+        for (uint32_t cx = 0; cx < chromaWidth; cx++) {
+            int r = 0, g = 0, b = 0;
+            for (uint32_t dy = 0; dy < 2; dy++) {
+                uint32_t y = std::min(cy * 2 + dy, height - 1);
+                const uint8_t* src = frame.pixels + static_cast<size_t>(y) * frame.rowPitch;
+                for (uint32_t dx = 0; dx < 2; dx++) {
+                    uint32_t x = std::min(cx * 2 + dx, width - 1);
+                    r += src[x * 4 + ri];
+                    g += src[x * 4 + 1];
+                    b += src[x * 4 + bi];
+                }
+            }
+            int u = ((-43 * r - 85 * g + 128 * b) / 4 + 128) / 256 + 128;
+            int v = ((128 * r - 107 * g - 21 * b) / 4 + 128) / 256 + 128;
+            uPlane[static_cast<size_t>(cy) * chromaWidth + cx] = static_cast<uint8_t>(std::clamp(u, 0, 255));
+            vPlane[static_cast<size_t>(cy) * chromaWidth + cx] = static_cast<uint8_t>(std::clamp(v, 0, 255));
+        }
+    }
+
+    out << "FRAME\n";
+    out.write(reinterpret_cast<const char*>(scratch.data()), static_cast<std::streamsize>(scratch.size()));
+}
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Large chunks are written straight from `data`, without a copy.
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> header;
+    putBigEndian(header, static_cast<uint32_t>(data.size()));
+    header.insert(header.end(), type, type + 4);
+    std::vector<uint8_t> trailer;
+    putBigEndian(trailer, crc32(data.data(), data.size(), crc32(header.data() + 4, 4)));
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    file.write(reinterpret_cast<const char*>(trailer.data()), static_cast<std::streamsize>(trailer.size()));
+}
+
+// The sums are reduced only every 5552 bytes, the most that cannot overflow.
+static void adler32(const uint8_t* data, size_t size, uint32_t& a, uint32_t& b) {
+    while (size > 0) {
+        size_t run = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i < run; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += run;
+        size -= run;
+    }
+}
+
+// Appends `size` bytes as stored deflate blocks of at most 65535 bytes; only
+// the stream's last block carries the final flag.
+static void putStoredBlocks(std::vector<uint8_t>& out, const uint8_t* data, size_t size, bool final) {
+    for (size_t offset = 0; offset < size || offset == 0;) {
+        size_t len = std::min<size_t>(size - offset, 65535);
+        bool last = offset + len == size;
+        out.push_back(final && last ? 1 : 0);
+        out.push_back(static_cast<uint8_t>(len));
+        out.push_back(static_cast<uint8_t>(len >> 8));
+        out.push_back(static_cast<uint8_t>(~len));
+        out.push_back(static_cast<uint8_t>(~len >> 8));
+        out.insert(out.end(), data + offset, data + offset + len);
+        offset += len;
+        if (last) break;
+    }
+}
+
+static const uint8_t pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static void putChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    size_t start = out.size();
+    putBigEndian(out, static_cast<uint32_t>(data.size()));
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBigEndian(out, crc32(out.data() + start + 4, out.size() - start - 4));
+}
+
+// PNGs are written with stored (uncompressed) deflate blocks: compression
+// would cost far more CPU than the encoder thread has per frame at 60 Hz.
+void encodePng(const uint8_t* pixels, uint32_t rowPitch, uint32_t width, uint32_t height, bool bgra, std::vector<uint8_t>& png) {
+    size_t stride = static_cast<size_t>(width) * 3 + 1;
+    std::vector<uint8_t> scanlines(stride * height);
+    int ri = bgra ? 2 : 0;
+    int bi = bgra ? 0 : 2;
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* src = pixels + static_cast<size_t>(y) * rowPitch;
+        uint8_t* dst = scanlines.data() + y * stride;
+        dst[0] = 0; // filter: none
+        for (uint32_t x = 0; x < width; x++) {
+            dst[1 + x * 3 + 0] = src[x * 4 + ri];
+            dst[1 + x * 3 + 1] = src[x * 4 + 1];
+            dst[1 + x * 3 + 2] = src[x * 4 + bi];
+        }
+    }
+
+    std::vector<uint8_t> idat;
+    idat.reserve(scanlines.size() + scanlines.size() / 65535 * 5 + 16);
+    idat.push_back(0x78);
+    idat.push_back(0x01);
+    uint32_t a = 1, b = 0;
+    putStoredBlocks(idat, scanlines.data(), scanlines.size(), true);
+    adler32(scanlines.data(), scanlines.size(), a, b);
+    putBigEndian(idat, (b << 16) | a);
+
+    std::vector<uint8_t> ihdr;
+    putBigEndian(ihdr, width);
+    putBigEndian(ihdr, height);
+    ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 }); // 8-bit RGB, no interlace
+
+    png.assign(pngSignature, pngSignature + sizeof(pngSignature));
+    png.reserve(idat.size() + 64);
+    putChunk(png, "IHDR", ihdr);
+    putChunk(png, "IDAT", idat);
+    putChunk(png, "IEND", {});
+}
+
+void FrameEncoder::writePng(const CaptureFrame& frame) {
+    encodePng(frame.pixels, frame.rowPitch, width, height, bgra, scratch);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "_%06llu.png", static_cast<unsigned long long>(frame.index));
+    std::ofstream file(path + name, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) gLogFile << "capture: failed to open " << path << name << '\n';
+        return;
+    }
+    file.write(reinterpret_cast<const char*>(scratch.data()), static_cast<std::streamsize>(scratch.size()));
+}
+
+// The zlib stream runs across one IDAT chunk per band: its header goes out
+// with the first band and the checksum over all scanlines with the last.
+bool TileWriter::start(const std::string& path, uint32_t w, uint32_t h, uint32_t bandHeight, bool isBgra) {
+    width = w;
+    height = h;
+    bgra = isBgra;
+    stopping = false;
+    written = 0;
+    bandColumns = 0;
+    adlerA = 1;
+    adlerB = 0;
+
+    out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    band.assign((static_cast<size_t>(width) * 3 + 1) * bandHeight, 0);
+
+    std::vector<uint8_t> ihdr;
+    putBigEndian(ihdr, width);
+    putBigEndian(ihdr, height);
+    ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 }); // 8-bit RGB, no interlace
+    out.write(reinterpret_cast<const char*>(pngSignature), sizeof(pngSignature));
+    writeChunk(out, "IHDR", ihdr);
+    idat = { 0x78, 0x01 };
+
+    worker = std::thread(&TileWriter::run, this);
+    return true;
+}
+
+void TileWriter::push(const TileFrame& tile) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(tile);
+    }
+    wake.notify_one();
+}
+
+void TileWriter::stop() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+    writeChunk(out, "IEND", {});
+    out.close();
+}
+
+void TileWriter::run() {
+    setProfilerThreadName("tile writer");
+    for (;;) {
+        TileFrame tile;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            tile = queue.front();
+            queue.pop_front();
+        }
+        {
+            PROFILE_ZONE("place tile");
+            placeTile(tile);
+        }
+        tile.released->store(true, std::memory_order_release);
+    }
+}
+
+void TileWriter::placeTile(const TileFrame& tile) {
+    size_t stride = static_cast<size_t>(width) * 3 + 1;
+    int ri = bgra ? 2 : 0;
+    int bi = bgra ? 0 : 2;
+    for (uint32_t y = 0; y < tile.height; y++) {
+        const uint8_t* src = tile.pixels + static_cast<size_t>(y) * tile.rowPitch;
+        uint8_t* row = band.data() + y * stride;
+        row[0] = 0; // filter: none
+        uint8_t* dst = row + 1 + static_cast<size_t>(tile.x) * 3;
+        for (uint32_t x = 0; x < tile.width; x++) {
+            dst[x * 3 + 0] = src[x * 4 + ri];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + bi];
+        }
+    }
+
+    bandColumns += tile.width;
+    if (bandColumns < width) return;
+    bandColumns = 0;
+    writeBand(tile.height, tile.y + tile.height >= height);
+}
+
+void TileWriter::writeBand(uint32_t rows, bool last) {
+    size_t size = (static_cast<size_t>(width) * 3 + 1) * rows;
+    idat.reserve(size + size / 65535 * 5 + 16);
+    putStoredBlocks(idat, band.data(), size, last);
+    adler32(band.data(), size, adlerA, adlerB);
+    if (last) putBigEndian(idat, (adlerB << 16) | adlerA);
+
+    writeChunk(out, "IDAT", idat);
+    written.fetch_add(idat.size() + 12);
+    idat.clear();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class CaptureFormat : uint32_t {
+    Raw, // tightly packed RGBA8, one file
+    Y4M, // YUV 4:2:0 (full range BT.601), one file
+    Png, // one RGB PNG per frame, <path>_000000.png
+};
+
+bool parseCaptureFormat(const std::string& name, CaptureFormat& format);
+
+// Replaces `png` with an RGB PNG of the RGBA8 (or BGRA8) pixels.
+void encodePng(const uint8_t* pixels, uint32_t rowPitch, uint32_t width, uint32_t height, bool bgra, std::vector<uint8_t>& png);
+
+// A frame sitting in mapped readback memory. `released` is cleared once the
+// encoder no longer needs the pixels so the slot can be reused.
+struct CaptureFrame {
+    const uint8_t* pixels{};
+    uint32_t rowPitch{};
+    uint64_t index{};
+    std::atomic<bool>* released{};
+};
+
+// Converts and writes captured frames on a background thread so the render
+// loop only ever copies a pointer into the queue.
+class FrameEncoder {
+public:
+    ~FrameEncoder() { stop(); }
+
+    bool start(const std::string& path, CaptureFormat format, uint32_t width, uint32_t height, bool bgra, uint32_t fps);
+    void push(const CaptureFrame& frame);
+    // Writes everything still queued and joins the thread.
+    void stop();
+
+    bool running() const { return worker.joinable(); }
+    uint64_t framesWritten() const { return written.load(); }
+
+private:
+    void run();
+    void writeFrame(const CaptureFrame& frame);
+    void writeY4m(const CaptureFrame& frame);
+    void writePng(const CaptureFrame& frame);
+
+    std::string path;
+    CaptureFormat format = CaptureFormat::Raw;
+    uint32_t width{};
+    uint32_t height{};
+    bool bgra{};
+    std::ofstream out;
+    std::vector<uint8_t> scratch;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<CaptureFrame> queue;
+    bool stopping{};
+    std::atomic<uint64_t> written{0};
+};
+
+// One tile of a larger image sitting in mapped readback memory, placed at
+// (x, y) in the output.
+struct TileFrame {
+    const uint8_t* pixels{};
+    uint32_t rowPitch{};
+    uint32_t x{};
+    uint32_t y{};
+    uint32_t width{};
+    uint32_t height{};
+    std::atomic<bool>* released{};
+};
+
+// Streams an image too large to hold in memory into a single PNG. Tiles must
+// arrive row by row, left to right; each completed band of rows is written
+// out on a background thread, so only one band is ever held.
+class TileWriter {
+public:
+    ~TileWriter() { stop(); }
+
+    bool start(const std::string& path, uint32_t width, uint32_t height, uint32_t bandHeight, bool bgra);
+    void push(const TileFrame& tile);
+    // Writes everything still queued, finishes the file and joins the thread.
+    void stop();
+
+    uint64_t bytesWritten() const { return written.load(); }
+
+private:
+    void run();
+    void placeTile(const TileFrame& tile);
+    void writeBand(uint32_t rows, bool last);
+
+    uint32_t width{};
+    uint32_t height{};
+    bool bgra{};
+    std::ofstream out;
+    std::vector<uint8_t> band;
+    std::vector<uint8_t> idat;
+    uint32_t bandColumns{};
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<TileFrame> queue;
+    bool stopping{};
+    std::atomic<uint64_t> written{0};
+};
@@ -0,0 +1,259 @@
+#include "render/vulkan/capture/render_server.hpp"
+
+#include "render/vulkan/capture/frame_encoder.hpp"
+#include "core/metrics.hpp"
+#include "core/net.hpp"
+#include "core/profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+struct ServerClient {
+    intptr_t socket = -1;
+    std::mutex writeMutex;
+    std::thread reader;
+    std::atomic<bool> finished{false};
+
+    ~ServerClient() { closeSocket(socket); }
+};
+
+bool RenderServer::start(const std::string& path, uint32_t width, uint32_t height) {
+    socketPath = path;
+    maxWidth = width;
+    maxHeight = height;
+    shutdownRequested = false;
+    stopping = false;
+    latencyMetric = &gMetrics.histogram("voxel_server_latency_ms", "Render request arrival to response written in milliseconds.",
+                                        { 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 });
+
+    if (!initSockets()) return false;
+    listenSocket = listenUnix(path);
+    if (listenSocket < 0) {
+        cleanupSockets();
+        return false;
+    }
+
+    acceptor = std::thread(&RenderServer::acceptLoop, this);
+    responder = std::thread(&RenderServer::respondLoop, this);
+    return true;
+}
+
+void RenderServer::acceptLoop() {
+    for (;;) {
+        intptr_t s = acceptClient(listenSocket);
+        if (s < 0) {
+            if (shutdownRequested) return;
+            std::this_thread::sleep_for(std::chrono::duration<double>(ACCEPT_RETRY_SECONDS));
+            continue;
+        }
+        auto client = std::make_shared<ServerClient>();
+        client->socket = s;
+
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        for (auto it = clients.begin(); it != clients.end();) {
+            if ((*it)->finished) {
+                (*it)->reader.join();
+                it = clients.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        client->reader = std::thread(&RenderServer::readLoop, this, client);
+        clients.push_back(client);
+    }
+}
+
+void RenderServer::readLoop(std::shared_ptr<ServerClient> client) {
+    RenderRequest request;
+    while (readAll(client->socket, &request, sizeof(request))) {
+        // Anything else means the stream is out of step; drop the client.
+        if (request.magic != RENDER_REQUEST_MAGIC) break;
+
+        Response response;
+        response.pending = { request, client, std::chrono::steady_clock::now() };
+        response.header.status = ResponseStatus::Ok;
+        switch (request.type) {
+        case RequestType::Render: {
+            bool valid = request.width > 0 && request.height > 0 && request.width <= maxWidth && request.height <= maxHeight &&
+                         request.samples > 0 && (request.format == PayloadFormat::Rgba || request.format == PayloadFormat::Png);
+            if (valid && !shutdownRequested) {
+                {
+                    std::lock_guard<std::mutex> lock(requestMutex);
+                    requests.push_back(response.pending);
+                }
+                requestReady.notify_one();
+                continue;
+            }
+            response.header.status = valid ? ResponseStatus::ShuttingDown : ResponseStatus::BadRequest;
+            break;
+        }
+        case RequestType::Stats: {
+            std::string stats = statsJson();
+            response.payload.assign(stats.begin(), stats.end());
+            response.header.format = PayloadFormat::Json;
+            break;
+        }
+        case RequestType::Shutdown:
+            shutdownRequested = true;
+            requestReady.notify_all();
+            break;
+        default:
+            response.header.status = ResponseStatus::BadRequest;
+            break;
+        }
+        queueResponse(std::move(response));
+    }
+    client->finished = true;
+}
+
+bool RenderServer::takeBatch(std::vector<PendingRequest>& batch, size_t maxCount, double timeoutSeconds,
+                             const std::function<bool(const RenderRequest&)>& accept) {
+    std::unique_lock<std::mutex> lock(requestMutex);
+    requestReady.wait_for(lock, std::chrono::duration<double>(timeoutSeconds),
+                          [this] { return shutdownRequested || !requests.empty(); });
+    if (shutdownRequested) return false;
+
+    // The oldest request always fits an empty batch, so nothing waits forever
+    // behind requests that pack better.
+    for (auto it = requests.begin(); it != requests.end() && batch.size() < maxCount;) {
+        if (accept(it->request)) {
+            batch.push_back(std::move(*it));
+            it = requests.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return true;
+}
+
+void RenderServer::complete(PendingRequest pending, std::vector<uint8_t> pixels) {
+    Response response;
+    response.header.status = ResponseStatus::Ok;
+    response.header.width = pending.request.width;
+    response.header.height = pending.request.height;
+    response.header.format = pending.request.format;
+    response.encodePng = pending.request.format == PayloadFormat::Png;
+    response.pending = std::move(pending);
+    response.payload = std::move(pixels);
+    queueResponse(std::move(response));
+}
+
+void RenderServer::noteBatch(size_t count) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    batches++;
+    batchedRequests += count;
+}
+
+size_t RenderServer::queuedRequests() {
+    std::lock_guard<std::mutex> lock(requestMutex);
+    return requests.size();
+}
+
+void RenderServer::queueResponse(Response response) {
+    {
+        std::lock_guard<std::mutex> lock(responseMutex);
+        responses.push_back(std::move(response));
+    }
+    responseReady.notify_one();
+}
+
+void RenderServer::respondLoop() {
+    setProfilerThreadName("render server");
+    for (;;) {
+        Response response;
+        {
+            std::unique_lock<std::mutex> lock(responseMutex);
+            responseReady.wait(lock, [this] { return stopping || !responses.empty(); });
+            if (responses.empty()) return;
+            response = std::move(responses.front());
+            responses.pop_front();
+        }
+
+        PROFILE_ZONE("respond");
+        if (response.encodePng) {
+            std::vector<uint8_t> png;
+            encodePng(response.payload.data(), response.header.width * 4, response.header.width, response.header.height, false, png);
+            response.payload.swap(png);
+        }
+        response.header.magic = RENDER_RESPONSE_MAGIC;
+        response.header.id = response.pending.request.id;
+        response.header.size = response.payload.size();
+
+        ServerClient& client = *response.pending.client;
+        {
+            std::lock_guard<std::mutex> lock(client.writeMutex);
+            if (!writeAll(client.socket, &response.header, sizeof(response.header)) ||
+                !writeAll(client.socket, response.payload.data(), response.payload.size())) {
+                continue;
+            }
+        }
+
+        if (response.pending.request.type != RequestType::Render || response.header.status != ResponseStatus::Ok) continue;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - response.pending.arrival).count();
+        latencyMetric->observe(ms);
+        std::lock_guard<std::mutex> lock(statsMutex);
+        latencyMs.push_back(ms);
+        if (latencyMs.size() > LATENCY_WINDOW) latencyMs.pop_front();
+        completed++;
+    }
+}
+
+void RenderServer::stop() {
+    if (!acceptor.joinable()) return;
+
+    shutdownRequested = true;
+    shutdownSocket(listenSocket);
+    acceptor.join();
+    closeSocket(listenSocket);
+    listenSocket = -1;
+    std::remove(socketPath.c_str());
+
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        for (auto& client : clients) shutdownSocket(client->socket);
+        for (auto& client : clients) client->reader.join();
+        clients.clear();
+    }
+
+    // Whatever was still queued gets an answer instead of a dropped connection.
+    {
+        std::lock_guard<std::mutex> lock(requestMutex);
+        for (auto& pending : requests) {
+            Response response;
+            response.pending = std::move(pending);
+            response.header.status = ResponseStatus::ShuttingDown;
+            queueResponse(std::move(response));
+        }
+        requests.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(responseMutex);
+        stopping = true;
+    }
+    responseReady.notify_one();
+    responder.join();
+    cleanupSockets();
+}
+
+// Latency percentiles cover the most recent LATENCY_WINDOW requests.
+std::string RenderServer::statsJson() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    std::vector<double> sorted(latencyMs.begin(), latencyMs.end());
+    std::sort(sorted.begin(), sorted.end());
+    auto pct = [&](double p) {
+        if (sorted.empty()) return 0.0;
+        return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5)];
+    };
+    double sum = 0.0;
+    for (double v : sorted) sum += v;
+
+    char buf[384];
+    std::snprintf(buf, sizeof(buf),
+                  "{ \"requests\": %llu, \"batches\": %llu, \"avg_batch\": %.2f, \"latency_ms\": "
+                  "{ \"avg\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f } }",
+                  static_cast<unsigned long long>(completed), static_cast<unsigned long long>(batches),
+                  batches ? static_cast<double>(batchedRequests) / static_cast<double>(batches) : 0.0,
+                  sorted.empty() ? 0.0 : sum / static_cast<double>(sorted.size()), pct(0.50), pct(0.95), pct(0.99),
+                  sorted.empty() ? 0.0 : sorted.back());
+    return buf;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MetricHistogram;
+
+// Wire format of the render server. Every message is a fixed header in host
+// byte order (the socket is local), responses are followed by `size` bytes.
+constexpr uint32_t RENDER_REQUEST_MAGIC = 0x51525856;  // "VXRQ"
+constexpr uint32_t RENDER_RESPONSE_MAGIC = 0x53525856; // "VXRS"
+
+enum class RequestType : uint32_t {
+    Render = 0,
+    Stats = 1,    // answered with a JSON text payload
+    Shutdown = 2,
+};
+
+enum class PayloadFormat : uint32_t {
+    Rgba = 0, // tightly packed RGBA8
+    Png = 1,
+    Json = 2,
+};
+
+enum class ResponseStatus : uint32_t {
+    Ok = 0,
+    BadRequest = 1,
+    ShuttingDown = 2,
+};
+
+struct RenderRequest {
+    uint32_t magic{};
+    RequestType type{};
+    uint32_t id{};
+    uint32_t width{};
+    uint32_t height{};
+    uint32_t samples{};
+    PayloadFormat format{};
+    float x{};
+    float y{};
+    float z{};
+    float yaw{};   // radians, as the fly camera
+    float pitch{};
+};
+
+struct RenderResponse {
+    uint32_t magic{};
+    uint32_t id{};
+    ResponseStatus status{};
+    uint32_t width{};
+    uint32_t height{};
+    PayloadFormat format{};
+    uint64_t size{};
+};
+
+static_assert(sizeof(RenderRequest) == 48, "RenderRequest is part of the wire format");
+static_assert(sizeof(RenderResponse) == 32, "RenderResponse is part of the wire format");
+
+struct ServerClient;
+
+struct PendingRequest {
+    RenderRequest request{};
+    std::shared_ptr<ServerClient> client;
+    std::chrono::steady_clock::time_point arrival;
+};
+
+// Accepts clients on a Unix domain socket, queues their render requests for
+// the render thread to take in batches, and encodes and sends the results on
+// a response thread. Latency is measured from a request being read to its
+// response being written.
+class RenderServer {
+public:
+    ~RenderServer() { stop(); }
+
+    bool start(const std::string& path, uint32_t maxWidth, uint32_t maxHeight);
+    // Moves queued render requests into `batch` in arrival order, skipping
+    // those `accept` turns down, until `maxCount` are taken. Waits up to
+    // `timeoutSeconds` for the first one. Returns false once shutdown was
+    // requested.
+    bool takeBatch(std::vector<PendingRequest>& batch, size_t maxCount, double timeoutSeconds,
+                   const std::function<bool(const RenderRequest&)>& accept);
+    // `pixels` are the request's tightly packed RGBA8 pixels.
+    void complete(PendingRequest pending, std::vector<uint8_t> pixels);
+    void noteBatch(size_t requests);
+    size_t queuedRequests();
+    void stop();
+
+    std::string statsJson();
+
+private:
+    struct Response {
+        PendingRequest pending;
+        RenderResponse header{};
+        std::vector<uint8_t> payload;
+        bool encodePng{};
+    };
+
+    const double ACCEPT_RETRY_SECONDS = 0.01;
+    const size_t LATENCY_WINDOW = 10000;
+
+    void acceptLoop();
+    void readLoop(std::shared_ptr<ServerClient> client);
+    void respondLoop();
+    void queueResponse(Response response);
+
+    std::string socketPath;
+    intptr_t listenSocket = -1;
+    uint32_t maxWidth{};
+    uint32_t maxHeight{};
+
+    std::thread acceptor;
+    std::mutex clientsMutex;
+    std::vector<std::shared_ptr<ServerClient>> clients;
+
+    std::mutex requestMutex;
+    std::condition_variable requestReady;
+    std::deque<PendingRequest> requests;
+    std::atomic<bool> shutdownRequested{false};
+
+    std::thread responder;
+    std::mutex responseMutex;
+    std::condition_variable responseReady;
+    std::deque<Response> responses;
+    bool stopping{};
+
+    std::mutex statsMutex;
+    MetricHistogram* latencyMetric{};
+    std::deque<double> latencyMs;
+    uint64_t completed{};
+    uint64_t batches{};
+    uint64_t batchedRequests{};
+};
@@ -0,0 +1,142 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+// A screenshot is rendered headless, one tile at a time, into an offscreen
+// target of one tile. Each tile is its own sub-frustum of the full image and
+// is refined over several full-resolution samples exactly like a still
+// camera. The last sample is copied into a capture slot, and the TileWriter
+// thread assembles tiles into bands of rows and streams them into the PNG
+// while the GPU renders the next tile. Memory stays at a few tiles plus one
+// band, whatever the image size.
+
+void VulkanAppImpl::renderScreenshot() {
+    uint32_t width = options.screenshotWidth;
+    uint32_t height = options.screenshotHeight;
+    if (width == 0 || height == 0 || options.screenshotTile == 0) {
+        throw std::runtime_error("Invalid screenshot size");
+    }
+    if (captureSlots.empty()) throw std::runtime_error("Failed to create screenshot readback buffers");
+    uint32_t samples = std::max(options.screenshotSamples, 1u);
+    uint32_t tileWidth = swapchainExtent.width;
+    uint32_t tileHeight = swapchainExtent.height;
+
+    TileWriter writer;
+    if (!writer.start(options.screenshotOutput, width, height, tileHeight, false)) {
+        throw std::runtime_error("Failed to open screenshot output " + options.screenshotOutput);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t tiles = 0;
+    for (uint32_t y = 0; y < height; y += tileHeight) {
+        for (uint32_t x = 0; x < width; x += tileWidth) {
+            VkRect2D tile{};
+            tile.offset = { static_cast<int32_t>(x), static_cast<int32_t>(y) };
+            tile.extent = { std::min(tileWidth, width - x), std::min(tileHeight, height - y) };
+
+            // History and the far layer belong to one tile; nothing is
+            // reprojected across tiles.
+            offscreenViews = { tileView(renderCamera, tile, { width, height }) };
+            renderViews = offscreenViews;
+            historyViews = renderViews;
+            historyValid = false;
+            farValid = false;
+
+            for (uint32_t sample = 1; sample <= samples; sample++) {
+                captureRequested = sample == samples;
+                if (captureRequested) waitForCaptureSlot();
+                refineSamples = sample;
+                renderOffscreenFrame();
+            }
+
+            vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+            for (auto& slot : captureSlots) {
+                if (!slot.recorded) continue;
+                slot.recorded = false;
+                writer.push({ slot.pixels, tileWidth * 4, x, y, tile.extent.width, tile.extent.height, &slot.released });
+            }
+            tiles++;
+        }
+    }
+    writer.stop();
+    captureRequested = true;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        char line[256];
+        std::snprintf(line, sizeof(line),
+                      "screenshot: %ux%u in %u tiles of %ux%u, %u samples, %.1f s (%.1f Mpixel/s), %.1f MB written to %s\n",
+                      width, height, tiles, tileWidth, tileHeight, samples, seconds,
+                      static_cast<double>(width) * height / 1e6 / seconds,
+                      static_cast<double>(writer.bytesWritten()) / (1024.0 * 1024.0), options.screenshotOutput.c_str());
+        gLogFile << line;
+        gLogFile.flush();
+    }
+}
+
+// drawFrame without acquire and present: the offscreen target is always
+// available and nothing waits on the result but the fence.
+void VulkanAppImpl::renderOffscreenFrame() {
+    PROFILE_ZONE("renderOffscreenFrame");
+    vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+    collectGpuTimings();
+    collectRenderStats();
+    collectCostMap();
+    collectCaptures();
+    vkResetFences(device, 1, &inFlightFence);
+
+    refineFrame++;
+    scheduleHeightCacheUpdate();
+    updateCameraBuffer();
+
+    vkResetCommandBuffer(commandBuffers[0], 0);
+    recordCommandBuffer(commandBuffers[0], 0);
+    advanceHistory();
+    advanceFarField();
+
+    bool computeSubmitted = frameGraph.hasWork(RenderQueue::Compute);
+    if (computeSubmitted) submitHeightCacheUpdate();
+    heightCacheUpdateSlot = -1;
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    uint64_t waitValue = heightCacheReadyValue;
+    if (computeSubmitted && frameGraph.graphicsWaitStages() != 0) {
+        waitValue = computeTimelineValue;
+        waitStage = static_cast<VkPipelineStageFlags>(frameGraph.graphicsWaitStages());
+    }
+    bool waitForCompute = asyncComputeEnabled && waitValue > 0;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = &waitValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = waitForCompute ? &timelineInfo : nullptr;
+    submitInfo.waitSemaphoreCount = waitForCompute ? 1 : 0;
+    submitInfo.pWaitSemaphores = &computeTimeline;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffers[0];
+
+    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit offscreen command buffer");
+    }
+}
+
+// Unlike a video capture, a screenshot or batch cannot drop an image, so the
+// render loop waits for the writer to hand a slot back.
+void VulkanAppImpl::waitForCaptureSlot() {
+    for (;;) {
+        for (const auto& slot : captureSlots) {
+            if (!slot.recorded && slot.released.load(std::memory_order_acquire)) return;
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(CAPTURE_SLOT_POLL_SECONDS));
+    }
+}
@@ -0,0 +1,133 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+#include "render/vulkan/capture/render_server.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+// Server mode keeps one headless device, its pipelines and the height cache
+// alive between requests. Queued requests with the same sample count are
+// shelf-packed into the offscreen target, up to MAX_RENDER_VIEWS of them, and
+// rendered as the views of one dispatch. Each request's pixels are cropped
+// out of the readback and handed to the server, whose response thread does
+// the PNG encoding while the GPU renders the next batch.
+
+void VulkanAppImpl::serveRequests() {
+    if (captureSlots.empty()) throw std::runtime_error("Failed to create server readback buffers");
+    uint32_t width = swapchainExtent.width;
+    uint32_t height = swapchainExtent.height;
+
+    RenderServer server;
+    if (!server.start(options.serveSocket, width, height)) {
+        throw std::runtime_error("Failed to listen on " + options.serveSocket);
+    }
+    {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) {
+            gLogFile << "server: listening on " << options.serveSocket << ", " << width << "x" << height << " target, ready after "
+                     << initMs << " ms\n";
+            gLogFile.flush();
+        }
+    }
+
+    std::vector<PendingRequest> batch;
+    std::vector<VkRect2D> placed;
+    auto lastReport = std::chrono::steady_clock::now();
+    for (;;) {
+        batch.clear();
+        placed.clear();
+        uint32_t shelfX = 0;
+        uint32_t shelfY = 0;
+        uint32_t shelfHeight = 0;
+        uint32_t samples = 0;
+        // Shelf packing: left to right in rows as tall as their tallest request.
+        auto place = [&](const RenderRequest& request) {
+            if (samples != 0 && request.samples != samples) return false;
+            uint32_t x = shelfX;
+            uint32_t y = shelfY;
+            uint32_t rowHeight = shelfHeight;
+            if (x + request.width > width) {
+                x = 0;
+                y += shelfHeight;
+                rowHeight = 0;
+            }
+            if (y + request.height > height) return false;
+            placed.push_back({ { static_cast<int32_t>(x), static_cast<int32_t>(y) }, { request.width, request.height } });
+            shelfX = x + request.width;
+            shelfY = y;
+            shelfHeight = std::max(rowHeight, request.height);
+            samples = request.samples;
+            return true;
+        };
+        if (!server.takeBatch(batch, MAX_RENDER_VIEWS, SERVER_POLL_SECONDS, place)) break;
+        metrics.serverQueue->set(static_cast<double>(server.queuedRequests()));
+
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - lastReport).count() >= SERVER_REPORT_SECONDS) {
+            lastReport = now;
+            memoryTracker.refresh();
+            updateMemoryMetrics();
+            std::string stats = server.statsJson();
+            std::lock_guard<std::mutex> lock(gLogMutex);
+            if (gLogFile.is_open()) {
+                gLogFile << "server: " << stats << '\n';
+                gLogFile.flush();
+            }
+        }
+        if (batch.empty()) continue;
+        server.noteBatch(batch.size());
+
+        // Every batch starts from scratch: its views have nothing to do with
+        // the previous batch's.
+        offscreenViews.clear();
+        for (size_t i = 0; i < batch.size(); i++) {
+            const RenderRequest& request = batch[i].request;
+            RenderView view;
+            view.camera = poseCamera({ request.x, request.y, request.z, request.yaw, request.pitch });
+            view.viewport = placed[i];
+            offscreenViews.push_back(view);
+        }
+        renderCamera = offscreenViews.front().camera;
+        renderViews = offscreenViews;
+        historyViews = renderViews;
+        historyValid = false;
+        farValid = false;
+
+        for (uint32_t sample = 1; sample <= samples; sample++) {
+            captureRequested = sample == samples;
+            refineSamples = sample;
+            renderOffscreenFrame();
+        }
+        captureRequested = false;
+
+        vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+        for (auto& slot : captureSlots) {
+            if (!slot.recorded) continue;
+            uint32_t pitch = width * 4;
+            for (size_t i = 0; i < batch.size(); i++) {
+                const VkRect2D& rect = placed[i];
+                uint32_t rowBytes = rect.extent.width * 4;
+                std::vector<uint8_t> pixels(static_cast<size_t>(rowBytes) * rect.extent.height);
+                const uint8_t* src = slot.pixels + static_cast<size_t>(rect.offset.y) * pitch + static_cast<size_t>(rect.offset.x) * 4;
+                for (uint32_t row = 0; row < rect.extent.height; row++) {
+                    std::memcpy(pixels.data() + static_cast<size_t>(row) * rowBytes, src + static_cast<size_t>(row) * pitch, rowBytes);
+                }
+                server.complete(std::move(batch[i]), std::move(pixels));
+            }
+            slot.recorded = false;
+            slot.released = true;
+        }
+    }
+    vkDeviceWaitIdle(device);
+    server.stop();
+    captureRequested = true;
+
+    std::string stats = server.statsJson();
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        gLogFile << "server: stopped, " << stats << '\n';
+        gLogFile.flush();
+    }
+}
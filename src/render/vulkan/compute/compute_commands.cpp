@@ -1,5 +1,6 @@
 #include "render/vulkan/app/vulkan_app_impl.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 
 void VulkanAppImpl::createCommandPool() {
@@ -10,9 +11,20 @@ void VulkanAppImpl::createCommandPool() {
     poolInfo.queueFamilyIndex = indices.graphicsFamily.value();
     poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+    if (vkCreateCommandPool(device, &poolInfo, gVkAllocator, &commandPool) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create command pool");
     }
+
+    if (asyncComputeEnabled) {
+        VkCommandPoolCreateInfo computePoolInfo{};
+        computePoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        computePoolInfo.queueFamilyIndex = computeQueueFamily;
+        computePoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        if (vkCreateCommandPool(device, &computePoolInfo, gVkAllocator, &computeCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create compute command pool");
+        }
+    }
 }
 
 void VulkanAppImpl::createCommandBuffers() {
@@ -27,9 +39,22 @@ void VulkanAppImpl::createCommandBuffers() {
     if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate command buffers");
     }
+
+    if (asyncComputeEnabled) {
+        VkCommandBufferAllocateInfo computeAllocInfo{};
+        computeAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        computeAllocInfo.commandPool = computeCommandPool;
+        computeAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        computeAllocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device, &computeAllocInfo, &computeCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate compute command buffer");
+        }
+    }
 }
 
 void VulkanAppImpl::recordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex) {
+    PROFILE_ZONE("recordCommandBuffer");
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -37,77 +62,133 @@ void VulkanAppImpl::recordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex
         throw std::runtime_error("Failed to begin command buffer");
     }
 
-    VkImageMemoryBarrier toGeneral{};
-    toGeneral.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    toGeneral.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    toGeneral.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    toGeneral.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    toGeneral.subresourceRange.baseMipLevel = 0;
-    toGeneral.subresourceRange.levelCount = 1;
-    toGeneral.subresourceRange.baseArrayLayer = 0;
-    toGeneral.subresourceRange.layerCount = 1;
-    toGeneral.image = swapchainImages[imageIndex];
-    toGeneral.oldLayout = imageLayoutInitialized[imageIndex] ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_UNDEFINED;
-    toGeneral.newLayout = VK_IMAGE_LAYOUT_GENERAL;
-    toGeneral.srcAccessMask = 0;
-    toGeneral.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-
-    VkPipelineStageFlags srcStage = imageLayoutInitialized[imageIndex]
-        ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
-        : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-
-    VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    frameGraph.reset();
 
+    // The acquire semaphore is waited at the compute stage, so the first
+    // transition has to be ordered after that stage rather than TOP_OF_PIPE.
+    // An offscreen target is never presented and stays in GENERAL.
+    ResourceAccess targetFinal = accessFor(headless() ? ResourceUsage::ComputeWrite : ResourceUsage::Present);
+    ResourceAccess acquired{};
+    acquired.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    acquired.layout = imageLayoutInitialized[imageIndex] ? targetFinal.layout : VK_IMAGE_LAYOUT_UNDEFINED;
     imageLayoutInitialized[imageIndex] = true;
+    GraphResource target = frameGraph.importImage("swapchain", swapchainImages[imageIndex], swapchainImageViews[imageIndex],
+                                                  acquired, targetFinal);
+
+    // Each cache slot is its own resource so an update of the inactive slot
+    // does not serialise against the raymarch reading the active one. With no
+    // levels left under the memory budget neither slot is ever in use.
+    GraphResource cacheSlots[2]{};
+    if (heightCacheLevels > 0) {
+        VkDeviceSize slotBytes = static_cast<VkDeviceSize>(heightCacheLevels) * HEIGHT_CACHE_RES * HEIGHT_CACHE_RES * sizeof(float);
+        cacheSlots[0] = frameGraph.importBuffer("height-cache-0", heightCacheBuffer, 0, slotBytes);
+        cacheSlots[1] = frameGraph.importBuffer("height-cache-1", heightCacheBuffer, slotBytes, slotBytes);
+    }
 
-    vkCmdPipelineBarrier(
-        cmd,
-        srcStage,
-        dstStage,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &toGeneral);
-
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
-    VkDescriptorSet set = computeDescriptorSets[imageIndex];
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &set, 0, nullptr);
-
-    const uint32_t localSizeX = 16;
-    const uint32_t localSizeY = 16;
-    uint32_t renderWidth = swapchainExtent.width / RAYMARCH_UPSCALE;
-    uint32_t renderHeight = swapchainExtent.height / RAYMARCH_UPSCALE;
-    uint32_t groupCountX = (renderWidth + localSizeX - 1) / localSizeX;
-    uint32_t groupCountY = (renderHeight + localSizeY - 1) / localSizeY;
-
-    vkCmdDispatch(cmd, groupCountX, groupCountY, 1);
-
-    VkImageMemoryBarrier toPresent{};
-    toPresent.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    toPresent.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    toPresent.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    toPresent.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    toPresent.subresourceRange.baseMipLevel = 0;
-    toPresent.subresourceRange.levelCount = 1;
-    toPresent.subresourceRange.baseArrayLayer = 0;
-    toPresent.subresourceRange.layerCount = 1;
-    toPresent.image = swapchainImages[imageIndex];
-    toPresent.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
-    toPresent.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    toPresent.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    toPresent.dstAccessMask = 0;
-
-    vkCmdPipelineBarrier(
-        cmd,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &toPresent);
+    if (heightCacheUpdateSlot >= 0) {
+        uint32_t slot = static_cast<uint32_t>(heightCacheUpdateSlot);
+        int32_t centerX = heightCacheUpdateCenter[0];
+        int32_t centerZ = heightCacheUpdateCenter[1];
+        frameGraph.addPass("height-cache", RenderQueue::Compute, { { cacheSlots[slot], ResourceUsage::ComputeWrite } },
+                           [this, slot, centerX, centerZ](VkCommandBuffer c) { recordHeightCacheUpdate(c, slot, centerX, centerZ); });
+    }
+
+    std::vector<PassUse> raymarchUses = { { target, ResourceUsage::ComputeWrite } };
+    if (heightCacheActiveSlot >= 0) raymarchUses.push_back({ cacheSlots[heightCacheActiveSlot], ResourceUsage::ComputeRead });
+
+    // The history and far images are bound to every raymarch dispatch, so
+    // they are moved to GENERAL on the first frame even when unused. After
+    // that the history is only imported while refining or with temporal
+    // anti-aliasing; it is marked invalid whenever a frame skipped it, so its
+    // contents after the UNDEFINED transition are never read.
+    ResourceAccess storageAccess = accessFor(ResourceUsage::ComputeReadWrite);
+    if (historyWritten() || !historyLayoutInitialized) {
+        ResourceAccess historyInitial = historyLayoutInitialized ? storageAccess : ResourceAccess{};
+        GraphResource history = frameGraph.importImage("history", historyImage, historyView, historyInitial, storageAccess);
+        if (historyWritten()) raymarchUses.push_back({ history, ResourceUsage::ComputeReadWrite });
+        historyLayoutInitialized = true;
+    }
+
+    bool farEnabled = options.farDistance > 0.0;
+    if (farEnabled || !farLayoutInitialized) {
+        ResourceAccess farInitial = farLayoutInitialized ? storageAccess : ResourceAccess{};
+        GraphResource far = frameGraph.importImage("far-field", farImage, farView, farInitial, storageAccess);
+        farLayoutInitialized = true;
+        if (farEnabled) {
+            // The far pass shares the raymarch's descriptor set, which
+            // includes the output image, so it has to be in GENERAL already.
+            std::vector<PassUse> farUses = { { far, ResourceUsage::ComputeReadWrite }, { target, ResourceUsage::ComputeWrite } };
+            if (heightCacheActiveSlot >= 0) farUses.push_back({ cacheSlots[heightCacheActiveSlot], ResourceUsage::ComputeRead });
+            frameGraph.addPass("far-field", RenderQueue::Graphics, farUses,
+                               [this, imageIndex](VkCommandBuffer c) { recordFarFieldUpdate(c, imageIndex); });
+            raymarchUses.push_back({ far, ResourceUsage::ComputeRead });
+        }
+    }
+    frameGraph.addPass("raymarch", RenderQueue::Graphics, raymarchUses, [this, imageIndex](VkCommandBuffer c) {
+        if (timestampPool) {
+            vkCmdResetQueryPool(c, timestampPool, TS_RAYMARCH_BEGIN, 2);
+            vkCmdWriteTimestamp(c, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, TS_RAYMARCH_BEGIN);
+        }
+
+        vkCmdBindPipeline(c, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+        VkDescriptorSet set = computeDescriptorSets[imageIndex];
+        vkCmdBindDescriptorSets(c, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &set, 0, nullptr);
+
+        // One z slice per view, each sized for the largest viewport.
+        // Refinement frames trace every pixel instead of one per upscale block.
+        const uint32_t localSizeX = 16;
+        const uint32_t localSizeY = 16;
+        uint32_t upscale = refineSamples > 0 ? 1 : traceBlock;
+        uint32_t renderWidth = 0;
+        uint32_t renderHeight = 0;
+        for (const auto& view : renderViews) {
+            renderWidth = std::max(renderWidth, view.viewport.extent.width / upscale);
+            renderHeight = std::max(renderHeight, view.viewport.extent.height / upscale);
+        }
+        uint32_t groupCountX = (renderWidth + localSizeX - 1) / localSizeX;
+        uint32_t groupCountY = (renderHeight + localSizeY - 1) / localSizeY;
+
+        vkCmdDispatch(c, groupCountX, groupCountY, static_cast<uint32_t>(renderViews.size()));
+
+        if (timestampPool) {
+            vkCmdWriteTimestamp(c, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, TS_RAYMARCH_END);
+            raymarchQueriesWritten = true;
+        }
+        if (renderStatsMapped || costMapMapped) {
+            // The step counters of this and the far pass, and the cost map, are
+            // read on the host after the fence.
+            VkMemoryBarrier toHost{};
+            toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            toHost.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            vkCmdPipelineBarrier(c, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost,
+                                 0, nullptr, 0, nullptr);
+        }
+    });
+    addCapturePass(target);
+
+    frameGraph.compile(asyncComputeEnabled);
+
+    VkCommandBuffer computeCmd = VK_NULL_HANDLE;
+    if (frameGraph.hasWork(RenderQueue::Compute)) {
+        computeCmd = computeCommandBuffer;
+        vkResetCommandBuffer(computeCmd, 0);
+
+        VkCommandBufferBeginInfo computeBeginInfo{};
+        computeBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        computeBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(computeCmd, &computeBeginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to begin compute command buffer");
+        }
+    }
+
+    frameGraph.execute(cmd, computeCmd);
+
+    if (computeCmd && vkEndCommandBuffer(computeCmd) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record compute command buffer");
+    }
 
     if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
         throw std::runtime_error("Failed to record command buffer");
     }
 }
-
@@ -20,14 +20,14 @@ VkShaderModule VulkanAppImpl::createShaderModule(const std::vector<char>& code)
     createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
     VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+    if (vkCreateShaderModule(device, &createInfo, gVkAllocator, &shaderModule) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create shader module");
     }
     return shaderModule;
 }
 
 void VulkanAppImpl::createComputeDescriptorSetLayout() {
-    VkDescriptorSetLayoutBinding bindings[2]{};
+    VkDescriptorSetLayoutBinding bindings[8]{};
     bindings[0].binding = 0;
     bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
     bindings[0].descriptorCount = 1;
@@ -38,18 +38,48 @@ void VulkanAppImpl::createComputeDescriptorSetLayout() {
     bindings[1].descriptorCount = 1;
     bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
+    bindings[2].binding = 2;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[3].binding = 3;
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[3].descriptorCount = 1;
+    bindings[3].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[4].binding = 4;
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[4].descriptorCount = 1;
+    bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[5].binding = 5;
+    bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[5].descriptorCount = 1;
+    bindings[5].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[6].binding = 6;
+    bindings[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[6].descriptorCount = 1;
+    bindings[6].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[7].binding = 7;
+    bindings[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[7].descriptorCount = 1;
+    bindings[7].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
     VkDescriptorSetLayoutCreateInfo info{};
     info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    info.bindingCount = 2;
+    info.bindingCount = 8;
     info.pBindings = bindings;
 
-    if (vkCreateDescriptorSetLayout(device, &info, nullptr, &computeDescriptorSetLayout) != VK_SUCCESS) {
+    if (vkCreateDescriptorSetLayout(device, &info, gVkAllocator, &computeDescriptorSetLayout) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create compute descriptor set layout");
     }
 }
 
 void VulkanAppImpl::createComputePipeline() {
-    auto compCode = readFile("shaders/cube.comp.spv");
+    auto compCode = readFile(costHeatmapEnabled ? "shaders/cube_cost.comp.spv" : "shaders/cube.comp.spv");
     VkShaderModule compModule = createShaderModule(compCode);
 
     VkPipelineShaderStageCreateInfo stageInfo{};
@@ -63,40 +93,70 @@ void VulkanAppImpl::createComputePipeline() {
     layoutInfo.setLayoutCount = 1;
     layoutInfo.pSetLayouts = &computeDescriptorSetLayout;
 
-    if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &computePipelineLayout) != VK_SUCCESS) {
-        vkDestroyShaderModule(device, compModule, nullptr);
+    if (vkCreatePipelineLayout(device, &layoutInfo, gVkAllocator, &computePipelineLayout) != VK_SUCCESS) {
+        vkDestroyShaderModule(device, compModule, gVkAllocator);
         throw std::runtime_error("Failed to create compute pipeline layout");
     }
 
-    VkComputePipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    pipelineInfo.stage = stageInfo;
-    pipelineInfo.layout = computePipelineLayout;
+    // The far layer update is the same shader with FAR_FIELD_PASS set;
+    // RENDER_STATS applies to both.
+    VkBool32 constants[2][2] = { { VK_FALSE, VK_FALSE }, { VK_TRUE, VK_FALSE } };
+    constants[0][1] = constants[1][1] = options.renderStatsOutput.empty() ? VK_FALSE : VK_TRUE;
+    VkSpecializationMapEntry entries[2]{};
+    for (uint32_t i = 0; i < 2; i++) {
+        entries[i].constantID = i;
+        entries[i].offset = i * sizeof(VkBool32);
+        entries[i].size = sizeof(VkBool32);
+    }
+
+    VkSpecializationInfo specializations[2]{};
+    for (uint32_t i = 0; i < 2; i++) {
+        specializations[i].mapEntryCount = 2;
+        specializations[i].pMapEntries = entries;
+        specializations[i].dataSize = sizeof(constants[i]);
+        specializations[i].pData = constants[i];
+    }
 
-    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
-        vkDestroyShaderModule(device, compModule, nullptr);
+    VkComputePipelineCreateInfo pipelineInfos[2]{};
+    pipelineInfos[0].sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfos[0].flags = pipelineCaptureFlags();
+    pipelineInfos[0].stage = stageInfo;
+    pipelineInfos[0].stage.pSpecializationInfo = &specializations[0];
+    pipelineInfos[0].layout = computePipelineLayout;
+    pipelineInfos[1] = pipelineInfos[0];
+    pipelineInfos[1].stage.pSpecializationInfo = &specializations[1];
+
+    VkPipeline pipelines[2]{};
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 2, pipelineInfos, gVkAllocator, pipelines) != VK_SUCCESS) {
+        vkDestroyShaderModule(device, compModule, gVkAllocator);
         throw std::runtime_error("Failed to create compute pipeline");
     }
+    computePipeline = pipelines[0];
+    farFieldPipeline = pipelines[1];
 
-    vkDestroyShaderModule(device, compModule, nullptr);
+    vkDestroyShaderModule(device, compModule, gVkAllocator);
+    capturePipelineStatistics(computePipeline, "cube.comp");
+    capturePipelineStatistics(farFieldPipeline, "cube.comp (far field)");
 }
 
 void VulkanAppImpl::createComputeDescriptorPool() {
     uint32_t count = static_cast<uint32_t>(swapchainImages.size());
 
-    VkDescriptorPoolSize poolSizes[2]{};
+    VkDescriptorPoolSize poolSizes[3]{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    poolSizes[0].descriptorCount = count;
+    poolSizes[0].descriptorCount = count * 3;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     poolSizes[1].descriptorCount = count;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = count * 4;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.maxSets = count;
-    poolInfo.poolSizeCount = 2;
+    poolInfo.poolSizeCount = 3;
     poolInfo.pPoolSizes = poolSizes;
 
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &computeDescriptorPool) != VK_SUCCESS) {
+    if (vkCreateDescriptorPool(device, &poolInfo, gVkAllocator, &computeDescriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create compute descriptor pool");
     }
 }
@@ -126,7 +186,35 @@ void VulkanAppImpl::createComputeDescriptorSets() {
         bufferInfo.offset = 0;
         bufferInfo.range = sizeof(CameraUBO);
 
-        VkWriteDescriptorSet writes[2]{};
+        VkDescriptorBufferInfo cacheInfo{};
+        cacheInfo.buffer = heightCacheBuffer;
+        cacheInfo.offset = 0;
+        cacheInfo.range = VK_WHOLE_SIZE;
+
+        VkDescriptorImageInfo historyInfo{};
+        historyInfo.imageView = historyView;
+        historyInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo farInfo{};
+        farInfo.imageView = farView;
+        farInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorBufferInfo statsInfo{};
+        statsInfo.buffer = renderStatsBuffer;
+        statsInfo.offset = 0;
+        statsInfo.range = VK_WHOLE_SIZE;
+
+        VkDescriptorBufferInfo costInfo{};
+        costInfo.buffer = costMapBuffer;
+        costInfo.offset = 0;
+        costInfo.range = VK_WHOLE_SIZE;
+
+        VkDescriptorBufferInfo structureInfo{};
+        structureInfo.buffer = structureAtlasBuffer;
+        structureInfo.offset = 0;
+        structureInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet writes[8]{};
         writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         writes[0].dstSet = computeDescriptorSets[i];
         writes[0].dstBinding = 0;
@@ -141,7 +229,49 @@ void VulkanAppImpl::createComputeDescriptorSets() {
         writes[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         writes[1].pBufferInfo = &bufferInfo;
 
-        vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+        writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[2].dstSet = computeDescriptorSets[i];
+        writes[2].dstBinding = 2;
+        writes[2].descriptorCount = 1;
+        writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[2].pBufferInfo = &cacheInfo;
+
+        writes[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[3].dstSet = computeDescriptorSets[i];
+        writes[3].dstBinding = 3;
+        writes[3].descriptorCount = 1;
+        writes[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[3].pImageInfo = &historyInfo;
+
+        writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[4].dstSet = computeDescriptorSets[i];
+        writes[4].dstBinding = 4;
+        writes[4].descriptorCount = 1;
+        writes[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[4].pImageInfo = &farInfo;
+
+        writes[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[5].dstSet = computeDescriptorSets[i];
+        writes[5].dstBinding = 5;
+        writes[5].descriptorCount = 1;
+        writes[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[5].pBufferInfo = &statsInfo;
+
+        writes[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[6].dstSet = computeDescriptorSets[i];
+        writes[6].dstBinding = 6;
+        writes[6].descriptorCount = 1;
+        writes[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[6].pBufferInfo = &costInfo;
+
+        writes[7].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[7].dstSet = computeDescriptorSets[i];
+        writes[7].dstBinding = 7;
+        writes[7].descriptorCount = 1;
+        writes[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[7].pBufferInfo = &structureInfo;
+
+        vkUpdateDescriptorSets(device, 8, writes, 0, nullptr);
     }
 }
 
@@ -0,0 +1,211 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// --cost-heatmap swaps the raymarch for cube_cost.comp.spv, which stores the
+// subgroup clock cycles of the invocation that drew every output pixel:
+// traversal (traceVoxel) and the total until the colour was known. After each
+// fence the host adds them to per-pixel sums, clears the map and writes the
+// frame's mean back as the overlay's scale. On exit the mean cost per pixel is
+// written as a false-colour PNG, and per-tile means, largest first, as JSON.
+// Without the option the buffer is a few bytes that only back the descriptor.
+// The layout must match CostMap in shaders/cube.comp.
+
+// Blue through green to red over log2 of the cost relative to `scale`, as
+// heatColor in cube.comp.
+static void heatColor(double cycles, double scale, uint8_t* rgb) {
+    double t = std::clamp(0.5 + 0.25 * std::log2(std::max(cycles, 1.0) / std::max(scale, 1.0)), 0.0, 1.0);
+    double channels[3] = { 2.0 * t - 1.0, 1.0 - std::abs(2.0 * t - 1.0), 1.0 - 2.0 * t };
+    for (int c = 0; c < 3; c++) rgb[c] = static_cast<uint8_t>(std::clamp(channels[c], 0.0, 1.0) * 255.0 + 0.5);
+}
+
+void VulkanAppImpl::createCostMapBuffer() {
+    size_t pixels = costHeatmapEnabled ? static_cast<size_t>(swapchainExtent.width) * swapchainExtent.height : 1;
+    VkDeviceSize size = (COST_MAP_HEADER_WORDS + 2 * pixels) * sizeof(uint32_t);
+
+    VkBufferCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.size = size;
+    info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &info, gVkAllocator, &costMapBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cost map buffer");
+    }
+
+    VkMemoryRequirements req{};
+    vkGetBufferMemoryRequirements(device, costMapBuffer, &req);
+
+    // The whole map is read every frame; cached memory keeps that cheap.
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+    VkMemoryPropertyFlags required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    uint32_t typeIndex = UINT32_MAX;
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount && typeIndex == UINT32_MAX; i++) {
+        VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+        if ((req.memoryTypeBits & (1u << i)) && (flags & required) == required && (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) {
+            typeIndex = i;
+        }
+    }
+    if (typeIndex == UINT32_MAX) typeIndex = findMemoryType(req.memoryTypeBits, required);
+
+    VkMemoryAllocateInfo alloc{};
+    alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = typeIndex;
+
+    if (memoryTracker.allocate(alloc, &costMapMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate cost map memory");
+    }
+    vkBindBufferMemory(device, costMapBuffer, costMapMemory, 0);
+
+    void* mapped = nullptr;
+    if (vkMapMemory(device, costMapMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to map cost map memory");
+    }
+    std::memset(mapped, 0, static_cast<size_t>(size));
+    if (!costHeatmapEnabled) return;
+
+    costMapMapped = static_cast<uint32_t*>(mapped);
+    costMapMapped[1] = options.costOverlay ? 1u : 0u;
+    costHeatmap.width = swapchainExtent.width;
+    costHeatmap.height = swapchainExtent.height;
+    costHeatmap.traversal.assign(pixels, 0);
+    costHeatmap.total.assign(pixels, 0);
+    costHeatmap.samples.assign(pixels, 0);
+}
+
+void VulkanAppImpl::destroyCostMapBuffer() {
+    if (costMapMemory) vkUnmapMemory(device, costMapMemory);
+    vkDestroyBuffer(device, costMapBuffer, gVkAllocator);
+    memoryTracker.free(costMapMemory);
+    costMapBuffer = VK_NULL_HANDLE;
+    costMapMemory = VK_NULL_HANDLE;
+    costMapMapped = nullptr;
+}
+
+// Only called once the frame that wrote the map has signalled its fence.
+void VulkanAppImpl::collectCostMap() {
+    if (!costMapMapped) return;
+    uint32_t* cost = costMapMapped + COST_MAP_HEADER_WORDS;
+    size_t pixels = costHeatmap.total.size();
+
+    uint64_t frameCycles = 0;
+    uint64_t drawn = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        uint32_t total = cost[2 * i + 1];
+        if (total == 0) continue;
+        costHeatmap.traversal[i] += cost[2 * i];
+        costHeatmap.total[i] += total;
+        costHeatmap.samples[i] += 1;
+        frameCycles += total;
+        drawn++;
+    }
+    if (drawn == 0) return;
+
+    costHeatmap.frames++;
+    std::memset(cost, 0, 2 * pixels * sizeof(uint32_t));
+    costMapMapped[0] = static_cast<uint32_t>(frameCycles / drawn);
+}
+
+void VulkanAppImpl::writeCostHeatmap() {
+    const CostHeatmap& map = costHeatmap;
+    if (map.frames == 0) return;
+    uint32_t width = map.width;
+    uint32_t height = map.height;
+
+    std::vector<double> mean(map.total.size(), 0.0);
+    double sum = 0.0;
+    double traversalSum = 0.0;
+    size_t covered = 0;
+    for (size_t i = 0; i < mean.size(); i++) {
+        if (map.samples[i] == 0) continue;
+        mean[i] = static_cast<double>(map.total[i]) / map.samples[i];
+        sum += mean[i];
+        traversalSum += static_cast<double>(map.traversal[i]) / map.samples[i];
+        covered++;
+    }
+    double scale = covered ? sum / static_cast<double>(covered) : 0.0;
+
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4, 255);
+    for (size_t i = 0; i < mean.size(); i++) {
+        if (map.samples[i] == 0) rgba[i * 4] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = 0;
+        else heatColor(mean[i], scale, &rgba[i * 4]);
+    }
+    std::vector<uint8_t> png;
+    encodePng(rgba.data(), width * 4, width, height, false, png);
+    std::string imagePath = options.costHeatmapOutput + ".png";
+    std::ofstream image(imagePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (image.is_open()) image.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+
+    struct Tile {
+        uint32_t x;
+        uint32_t y;
+        double cycles;
+        double traversal;
+    };
+    std::vector<Tile> tiles;
+    for (uint32_t ty = 0; ty < height; ty += COST_TILE) {
+        for (uint32_t tx = 0; tx < width; tx += COST_TILE) {
+            Tile tile{ tx, ty, 0.0, 0.0 };
+            uint32_t count = 0;
+            for (uint32_t y = ty; y < std::min(ty + COST_TILE, height); y++) {
+                for (uint32_t x = tx; x < std::min(tx + COST_TILE, width); x++) {
+                    size_t i = static_cast<size_t>(y) * width + x;
+                    if (map.samples[i] == 0) continue;
+                    tile.cycles += mean[i];
+                    tile.traversal += static_cast<double>(map.traversal[i]) / map.samples[i];
+                    count++;
+                }
+            }
+            if (count == 0) continue;
+            tile.cycles /= count;
+            tile.traversal /= count;
+            tiles.push_back(tile);
+        }
+    }
+    std::sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) { return a.cycles > b.cycles; });
+
+    std::string tilesPath = options.costHeatmapOutput + ".json";
+    std::ofstream out(tilesPath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) return;
+    double tileSum = 0.0;
+    for (const Tile& tile : tiles) tileSum += tile.cycles;
+
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "{\n  \"frames\": %llu,\n  \"size\": [%u, %u],\n  \"tile\": %u,\n  \"cycles_per_pixel\": %.1f,\n  \"traversal_share\": %.4f,\n",
+                  static_cast<unsigned long long>(map.frames), width, height, COST_TILE, scale,
+                  sum > 0.0 ? traversalSum / sum : 0.0);
+    out << buf;
+    out << "  \"tiles\": [";
+    for (size_t i = 0; i < tiles.size(); i++) {
+        const Tile& t = tiles[i];
+        std::snprintf(buf, sizeof(buf),
+                      "%s\n    { \"x\": %u, \"y\": %u, \"cycles\": %.1f, \"traversal_cycles\": %.1f, \"shading_cycles\": %.1f, \"share\": %.5f }",
+                      i ? "," : "", t.x, t.y, t.cycles, t.traversal, t.cycles - t.traversal,
+                      tileSum > 0.0 ? t.cycles / tileSum : 0.0);
+        out << buf;
+    }
+    out << "\n  ]\n}\n";
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        std::snprintf(buf, sizeof(buf),
+                      "cost heatmap: %llu frames, %.0f cycles per pixel (%.0f%% traversal), written to %s and %s\n",
+                      static_cast<unsigned long long>(map.frames), scale, sum > 0.0 ? 100.0 * traversalSum / sum : 0.0,
+                      imagePath.c_str(), tilesPath.c_str());
+        gLogFile << buf;
+        if (!tiles.empty()) {
+            std::snprintf(buf, sizeof(buf), "cost heatmap: costliest tile at %u,%u with %.0f cycles per pixel, %.1fx the mean\n",
+                          tiles[0].x, tiles[0].y, tiles[0].cycles, tiles[0].cycles / std::max(scale, 1.0));
+            gLogFile << buf;
+        }
+        gLogFile.flush();
+    }
+}
@@ -0,0 +1,84 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <stdexcept>
+
+// Near/far split: the raymarch only traces up to options.nearDistance and
+// takes anything further from the far layer, a half-resolution cache of colour
+// and distance. The far layer is reprojected every frame and only a budgeted
+// share of its texels, those with the largest reprojection error, is traced
+// again, which is what makes a view distance of tens of kilometres affordable.
+
+void VulkanAppImpl::createFarField() {
+    farExtent.width = (swapchainExtent.width + FAR_FIELD_BLOCK - 1) / FAR_FIELD_BLOCK;
+    farExtent.height = (swapchainExtent.height + FAR_FIELD_BLOCK - 1) / FAR_FIELD_BLOCK;
+
+    VkImageCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = VK_FORMAT_R32G32B32A32_UINT;
+    info.extent = { farExtent.width, farExtent.height, 1 };
+    info.mipLevels = 1;
+    info.arrayLayers = 2;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = VK_IMAGE_USAGE_STORAGE_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &info, gVkAllocator, &farImage) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create far field image");
+    }
+
+    VkMemoryRequirements req{};
+    vkGetImageMemoryRequirements(device, farImage, &req);
+
+    VkMemoryAllocateInfo alloc{};
+    alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (memoryTracker.allocate(alloc, &farMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate far field memory");
+    }
+    vkBindImageMemory(device, farImage, farMemory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = farImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.format = info.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 2;
+
+    if (vkCreateImageView(device, &viewInfo, gVkAllocator, &farView) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create far field image view");
+    }
+    farLayoutInitialized = false;
+    farValid = false;
+}
+
+void VulkanAppImpl::destroyFarField() {
+    vkDestroyImageView(device, farView, gVkAllocator);
+    vkDestroyImage(device, farImage, gVkAllocator);
+    memoryTracker.free(farMemory);
+}
+
+void VulkanAppImpl::recordFarFieldUpdate(VkCommandBuffer cmd, uint32_t imageIndex) {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, farFieldPipeline);
+    VkDescriptorSet set = computeDescriptorSets[imageIndex];
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &set, 0, nullptr);
+
+    const uint32_t localSize = 16;
+    vkCmdDispatch(cmd, (farExtent.width + localSize - 1) / localSize, (farExtent.height + localSize - 1) / localSize, 1);
+}
+
+void VulkanAppImpl::advanceFarField() {
+    if (farValid) metrics.farReused->add();
+    if (options.farDistance <= 0.0) {
+        farValid = false;
+        return;
+    }
+    farLayer ^= 1;
+    farValid = true;
+}
@@ -0,0 +1,342 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+// Terrain heights are cached in a small clipmap around the camera so the
+// raymarch reads one float instead of evaluating five fbm octaves per lookup.
+// The layout must match shaders/world/height_cache.glsl.
+
+void VulkanAppImpl::createHeightCacheBuffer(uint32_t levels) {
+    // An empty cache still needs a valid buffer behind the descriptors.
+    VkDeviceSize size = static_cast<VkDeviceSize>(HEIGHT_CACHE_SLOTS) * levels *
+                        HEIGHT_CACHE_RES * HEIGHT_CACHE_RES * sizeof(float);
+    if (size == 0) size = 256;
+
+    uint32_t families[] = { graphicsQueueFamily, computeQueueFamily };
+
+    VkBufferCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.size = size;
+    info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    if (graphicsQueueFamily != computeQueueFamily) {
+        info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        info.queueFamilyIndexCount = 2;
+        info.pQueueFamilyIndices = families;
+    } else {
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    if (vkCreateBuffer(device, &info, gVkAllocator, &heightCacheBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create height cache buffer");
+    }
+
+    VkMemoryRequirements req{};
+    vkGetBufferMemoryRequirements(device, heightCacheBuffer, &req);
+
+    VkMemoryAllocateInfo alloc{};
+    alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (memoryTracker.allocate(alloc, &heightCacheMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate height cache memory");
+    }
+    vkBindBufferMemory(device, heightCacheBuffer, heightCacheMemory, 0);
+    heightCacheLevels = levels;
+}
+
+void VulkanAppImpl::destroyHeightCacheBuffer() {
+    vkDestroyBuffer(device, heightCacheBuffer, gVkAllocator);
+    memoryTracker.free(heightCacheMemory);
+    heightCacheBuffer = VK_NULL_HANDLE;
+    heightCacheMemory = VK_NULL_HANDLE;
+}
+
+void VulkanAppImpl::writeHeightCacheDescriptors() {
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = heightCacheBuffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    std::vector<VkWriteDescriptorSet> writes;
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = heightCacheDescriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    writes.push_back(write);
+
+    // The raymarch sets are created later at startup and pick the buffer up
+    // themselves; after a resize they have to be pointed at the new one.
+    for (VkDescriptorSet set : computeDescriptorSets) {
+        write.dstSet = set;
+        write.dstBinding = 2;
+        writes.push_back(write);
+    }
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void VulkanAppImpl::createHeightCacheSetLayout() {
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, gVkAllocator, &heightCacheSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create height cache descriptor set layout");
+    }
+}
+
+// Runs on a worker thread during startup.
+void VulkanAppImpl::createHeightCachePipeline() {
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = sizeof(int32_t) * 4;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &heightCacheSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, gVkAllocator, &heightCachePipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create height cache pipeline layout");
+    }
+
+    auto code = readFile("shaders/height_cache.comp.spv");
+    VkShaderModule module = createShaderModule(code);
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.flags = pipelineCaptureFlags();
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = heightCachePipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, gVkAllocator, &heightCachePipeline);
+    vkDestroyShaderModule(device, module, gVkAllocator);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create height cache pipeline");
+    }
+    capturePipelineStatistics(heightCachePipeline, "height_cache.comp");
+}
+
+void VulkanAppImpl::createHeightCache() {
+    memoryTracker.refresh();
+    createHeightCacheBuffer(heightCacheLevelsWithinBudget());
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, gVkAllocator, &heightCacheDescriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create height cache descriptor pool");
+    }
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = heightCacheDescriptorPool;
+    setInfo.descriptorSetCount = 1;
+    setInfo.pSetLayouts = &heightCacheSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &setInfo, &heightCacheDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate height cache descriptor set");
+    }
+
+    writeHeightCacheDescriptors();
+
+    heightCacheActiveSlot = -1;
+    heightCachePendingSlot = -1;
+}
+
+void VulkanAppImpl::destroyHeightCache() {
+    vkDestroyPipeline(device, heightCachePipeline, gVkAllocator);
+    vkDestroyPipelineLayout(device, heightCachePipelineLayout, gVkAllocator);
+    vkDestroyDescriptorPool(device, heightCacheDescriptorPool, gVkAllocator);
+    vkDestroyDescriptorSetLayout(device, heightCacheSetLayout, gVkAllocator);
+    destroyHeightCacheBuffer();
+}
+
+void VulkanAppImpl::resizeHeightCache(uint32_t levels) {
+    // Both slots may be in flight on either queue; resizes are rare enough
+    // that draining the device is simpler than deferring the free.
+    vkDeviceWaitIdle(device);
+    uint32_t previous = heightCacheLevels;
+    destroyHeightCacheBuffer();
+    createHeightCacheBuffer(levels);
+    writeHeightCacheDescriptors();
+
+    heightCacheActiveSlot = -1;
+    heightCachePendingSlot = -1;
+    heightCacheUpdateSlot = -1;
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        gLogFile << "height cache: " << previous << " -> " << levels << " levels under memory budget\n";
+        gLogFile.flush();
+    }
+}
+
+uint32_t VulkanAppImpl::heightCacheLevelsWithinBudget() {
+    VkDeviceSize levelBytes = static_cast<VkDeviceSize>(HEIGHT_CACHE_SLOTS) * HEIGHT_CACHE_RES * HEIGHT_CACHE_RES * sizeof(float);
+    VkDeviceSize current = heightCacheMemory ? levelBytes * heightCacheLevels : 0;
+    VkDeviceSize available = memoryTracker.deviceLocalHeadroom(options.memoryBudgetFraction) + current;
+    return static_cast<uint32_t>(std::min<VkDeviceSize>(available / levelBytes, HEIGHT_CACHE_MAX_LEVELS));
+}
+
+void VulkanAppImpl::updateMemoryBudget(double now) {
+    memoryTracker.refresh();
+    uint32_t fit = heightCacheLevelsWithinBudget();
+
+    // Shrink as soon as the budget is exceeded, but only grow back one level at
+    // a time after things have been calm for a while, so the cache does not
+    // oscillate around the limit while other processes come and go.
+    if (fit < heightCacheLevels) {
+        resizeHeightCache(fit);
+        heightCacheResizeTime = now;
+        logMemoryUsage();
+    } else if (fit > heightCacheLevels && now - heightCacheResizeTime >= HEIGHT_CACHE_GROW_DELAY) {
+        resizeHeightCache(heightCacheLevels + 1);
+        heightCacheResizeTime = now;
+        logMemoryUsage();
+    }
+}
+
+void VulkanAppImpl::logMemoryUsage() {
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (!gLogFile.is_open()) return;
+
+    const auto& heaps = memoryTracker.heaps();
+    char line[192];
+    for (size_t i = 0; i < heaps.size(); i++) {
+        std::snprintf(line, sizeof(line), "memory heap %zu%s: usage %.1f / budget %.1f MiB (size %.1f MiB, engine %.1f MiB)%s\n",
+                      i, heaps[i].deviceLocal ? " (device local)" : "",
+                      heaps[i].usage / 1048576.0, heaps[i].budget / 1048576.0, heaps[i].size / 1048576.0,
+                      heaps[i].trackedUsage / 1048576.0, memoryTracker.budgetAvailable() ? "" : " [estimated]");
+        gLogFile << line;
+    }
+    HostAllocationStats host = hostAllocationStats();
+    std::snprintf(line, sizeof(line), "host allocations: %.1f KiB live (peak %.1f KiB) in %llu blocks, %llu total, %.1f KiB driver internal\n",
+                  host.bytes / 1024.0, host.peakBytes / 1024.0,
+                  static_cast<unsigned long long>(host.liveAllocations),
+                  static_cast<unsigned long long>(host.totalAllocations), host.internalBytes / 1024.0);
+    gLogFile << line;
+    gLogFile.flush();
+}
+
+void VulkanAppImpl::recordHeightCacheUpdate(VkCommandBuffer cmd, uint32_t slot, int32_t centerX, int32_t centerZ) {
+    uint64_t timestampMask = asyncComputeEnabled ? computeTimestampMask : graphicsTimestampMask;
+    bool timed = timestampPool && timestampMask != 0;
+    if (timed) {
+        vkCmdResetQueryPool(cmd, timestampPool, TS_HEIGHT_CACHE_BEGIN, 2);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, TS_HEIGHT_CACHE_BEGIN);
+    }
+
+    int32_t params[4] = { centerX, centerZ, static_cast<int32_t>(slot), static_cast<int32_t>(heightCacheLevels) };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, heightCachePipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, heightCachePipelineLayout, 0, 1, &heightCacheDescriptorSet, 0, nullptr);
+    vkCmdPushConstants(cmd, heightCachePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), params);
+
+    const uint32_t localSize = 16;
+    uint32_t groups = (HEIGHT_CACHE_RES + localSize - 1) / localSize;
+    vkCmdDispatch(cmd, groups, groups, heightCacheLevels);
+
+    if (timed) {
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, TS_HEIGHT_CACHE_END);
+        heightCacheQueriesWritten = true;
+        heightCacheQueriesAsync = asyncComputeEnabled;
+    }
+}
+
+void VulkanAppImpl::scheduleHeightCacheUpdate() {
+    // Must run after inFlightFence is waited: the inactive slot is then no
+    // longer read by any graphics submission and can be rewritten.
+    // An update decided on a frame whose acquire failed is still outstanding.
+    if (heightCacheUpdateSlot >= 0 || heightCacheLevels == 0) return;
+    if (heightCachePendingSlot >= 0) {
+        uint64_t completed = 0;
+        vkGetSemaphoreCounterValue(device, computeTimeline, &completed);
+        if (completed < heightCachePendingValue) return;
+
+        heightCacheActiveSlot = heightCachePendingSlot;
+        heightCacheCenter[0] = heightCachePendingCenter[0];
+        heightCacheCenter[1] = heightCachePendingCenter[1];
+        heightCacheReadyValue = heightCachePendingValue;
+        heightCachePendingSlot = -1;
+    }
+
+    float snap = static_cast<float>(HEIGHT_CACHE_SNAP);
+    int32_t centerX = static_cast<int32_t>(std::floor(renderCamera.pos.x / snap + 0.5f)) * HEIGHT_CACHE_SNAP;
+    int32_t centerZ = static_cast<int32_t>(std::floor(renderCamera.pos.z / snap + 0.5f)) * HEIGHT_CACHE_SNAP;
+    if (heightCacheActiveSlot >= 0 && centerX == heightCacheCenter[0] && centerZ == heightCacheCenter[1]) {
+        metrics.heightCacheHits->add();
+        return;
+    }
+    metrics.heightCacheMisses->add();
+
+    uint32_t slot = heightCacheActiveSlot == 0 ? 1 : 0;
+    heightCacheUpdateSlot = static_cast<int32_t>(slot);
+    heightCacheUpdateCenter[0] = centerX;
+    heightCacheUpdateCenter[1] = centerZ;
+
+    if (!asyncComputeEnabled) {
+        // Recorded ahead of the raymarch in this frame's command buffer.
+        heightCacheActiveSlot = static_cast<int32_t>(slot);
+        heightCacheCenter[0] = centerX;
+        heightCacheCenter[1] = centerZ;
+        return;
+    }
+
+    // The previous update's timestamps are complete by now; read them before
+    // the queries are reset for the next one.
+    if (heightCacheQueriesWritten) collectGpuTimings();
+}
+
+void VulkanAppImpl::submitHeightCacheUpdate() {
+    uint64_t signalValue = ++computeTimelineValue;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &computeCommandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &computeTimeline;
+
+    if (vkQueueSubmit(computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit height cache update");
+    }
+
+    heightCachePendingSlot = heightCacheUpdateSlot;
+    heightCachePendingCenter[0] = heightCacheUpdateCenter[0];
+    heightCachePendingCenter[1] = heightCacheUpdateCenter[1];
+    heightCachePendingValue = signalValue;
+}
@@ -0,0 +1,89 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <stdexcept>
+
+// While the camera is still, frames trace every pixel at full resolution with
+// a sub-pixel jitter and a soft shadow ray, and average them into a float
+// history image (the layer pair temporal anti-aliasing also uses, so moving
+// again starts from the refined image). After REFINE_MAX_SAMPLES the image is
+// converged and the render loop stops drawing until the camera moves again.
+// Any change drops straight back to the regular upscaled path.
+
+void VulkanAppImpl::createHistoryImage() {
+    VkImageCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    info.extent = { swapchainExtent.width, swapchainExtent.height, 1 };
+    info.mipLevels = 1;
+    info.arrayLayers = 2;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = VK_IMAGE_USAGE_STORAGE_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &info, gVkAllocator, &historyImage) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create history image");
+    }
+
+    VkMemoryRequirements req{};
+    vkGetImageMemoryRequirements(device, historyImage, &req);
+
+    VkMemoryAllocateInfo alloc{};
+    alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (memoryTracker.allocate(alloc, &historyMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate history image memory");
+    }
+    vkBindImageMemory(device, historyImage, historyMemory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = historyImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.format = info.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 2;
+
+    if (vkCreateImageView(device, &viewInfo, gVkAllocator, &historyView) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create history image view");
+    }
+    historyLayoutInitialized = false;
+    historyValid = false;
+    refineSamples = 0;
+}
+
+void VulkanAppImpl::destroyHistoryImage() {
+    vkDestroyImageView(device, historyView, gVkAllocator);
+    vkDestroyImage(device, historyImage, gVkAllocator);
+    memoryTracker.free(historyMemory);
+}
+
+static bool sameView(const CameraSnapshot& a, const CameraSnapshot& b) {
+    return a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z &&
+           a.forward.x == b.forward.x && a.forward.y == b.forward.y && a.forward.z == b.forward.z &&
+           a.up.x == b.up.x && a.up.y == b.up.y && a.up.z == b.up.z &&
+           a.velocity.x == b.velocity.x && a.velocity.y == b.velocity.y && a.velocity.z == b.velocity.z &&
+           a.yawRate == b.yawRate && a.pitchRate == b.pitchRate;
+}
+
+bool VulkanAppImpl::refinementConverged() {
+    // A capture needs a frame every interval, converged or not.
+    if (!options.idleRefinement || !captureSlots.empty() || refineSamples < REFINE_MAX_SAMPLES) return false;
+    CameraSnapshot latest;
+    cameraSnapshots.read(latest);
+    return sameView(latest, renderCamera);
+}
+
+void VulkanAppImpl::updateRefinement(const CameraSnapshot& previous) {
+    if (options.idleRefinement && sameView(previous, renderCamera)) {
+        if (refineSamples < REFINE_MAX_SAMPLES) refineSamples++;
+    } else {
+        refineSamples = 0;
+    }
+    refineFrame++;
+}
@@ -0,0 +1,120 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+// --render-stats builds the raymarch with RENDER_STATS, which counts the
+// traversal steps of every ray (primary, shadow and far layer) into a small
+// host-visible buffer. The buffer holds one frame's counts; the host adds them
+// to 64-bit totals and clears it after each fence, so the 32-bit atomics never
+// wrap. Without the option the buffer only backs the descriptor. The layout
+// must match RenderStats in shaders/cube.comp.
+
+void VulkanAppImpl::createRenderStatsBuffer() {
+    VkBufferCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.size = RENDER_STATS_COUNTERS * sizeof(uint32_t);
+    info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &info, gVkAllocator, &renderStatsBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create render stats buffer");
+    }
+
+    VkMemoryRequirements req{};
+    vkGetBufferMemoryRequirements(device, renderStatsBuffer, &req);
+
+    VkMemoryAllocateInfo alloc{};
+    alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = findMemoryType(req.memoryTypeBits,
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (memoryTracker.allocate(alloc, &renderStatsMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate render stats memory");
+    }
+    vkBindBufferMemory(device, renderStatsBuffer, renderStatsMemory, 0);
+
+    void* mapped = nullptr;
+    if (vkMapMemory(device, renderStatsMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to map render stats memory");
+    }
+    std::memset(mapped, 0, RENDER_STATS_COUNTERS * sizeof(uint32_t));
+    if (!options.renderStatsOutput.empty()) renderStatsMapped = static_cast<uint32_t*>(mapped);
+}
+
+void VulkanAppImpl::destroyRenderStatsBuffer() {
+    if (renderStatsMemory) vkUnmapMemory(device, renderStatsMemory);
+    vkDestroyBuffer(device, renderStatsBuffer, gVkAllocator);
+    memoryTracker.free(renderStatsMemory);
+    renderStatsBuffer = VK_NULL_HANDLE;
+    renderStatsMemory = VK_NULL_HANDLE;
+    renderStatsMapped = nullptr;
+}
+
+// Only called once the frame that wrote the counters has signalled its fence.
+void VulkanAppImpl::collectRenderStats() {
+    if (!renderStatsMapped) return;
+    const uint32_t* counters = renderStatsMapped;
+    if (counters[0] == 0) return;
+
+    renderStats.frames += 1;
+    renderStats.rays += counters[0];
+    renderStats.hits += counters[1];
+    renderStats.coarseSteps += counters[2];
+    renderStats.fineSteps += counters[3];
+    for (uint32_t b = 0; b < RENDER_STATS_COUNTERS - 4; b++) renderStats.stepHistogram[b] += counters[4 + b];
+    std::memset(renderStatsMapped, 0, RENDER_STATS_COUNTERS * sizeof(uint32_t));
+}
+
+// Flat keys, so regression baselines can name any of them.
+void VulkanAppImpl::writeRenderStats() {
+    std::ofstream out(options.renderStatsOutput, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) return;
+
+    const RenderStats& s = renderStats;
+    double rays = static_cast<double>(std::max<uint64_t>(s.rays, 1));
+    std::vector<double> ms = s.raymarchMs;
+    std::sort(ms.begin(), ms.end());
+    auto pct = [&](double p) {
+        if (ms.empty()) return 0.0;
+        return ms[static_cast<size_t>(p * static_cast<double>(ms.size() - 1) + 0.5)];
+    };
+    double sum = 0.0;
+    for (double v : ms) sum += v;
+
+    char buf[256];
+    out << "{\n";
+    std::snprintf(buf, sizeof(buf), "  \"frames\": %llu,\n  \"rays\": %llu,\n  \"hits\": %llu,\n",
+                  static_cast<unsigned long long>(s.frames), static_cast<unsigned long long>(s.rays),
+                  static_cast<unsigned long long>(s.hits));
+    out << buf;
+    std::snprintf(buf, sizeof(buf), "  \"coarse_steps\": %llu,\n  \"fine_steps\": %llu,\n",
+                  static_cast<unsigned long long>(s.coarseSteps), static_cast<unsigned long long>(s.fineSteps));
+    out << buf;
+    std::snprintf(buf, sizeof(buf),
+                  "  \"hit_fraction\": %.6f,\n  \"steps_per_ray\": %.4f,\n  \"coarse_steps_per_ray\": %.4f,\n  \"fine_steps_per_ray\": %.4f,\n",
+                  static_cast<double>(s.hits) / rays, static_cast<double>(s.coarseSteps + s.fineSteps) / rays,
+                  static_cast<double>(s.coarseSteps) / rays, static_cast<double>(s.fineSteps) / rays);
+    out << buf;
+    std::snprintf(buf, sizeof(buf), "  \"gpu_raymarch_ms_avg\": %.4f,\n  \"gpu_raymarch_ms_p50\": %.4f,\n  \"gpu_raymarch_ms_p95\": %.4f,\n",
+                  ms.empty() ? 0.0 : sum / static_cast<double>(ms.size()), pct(0.50), pct(0.95));
+    out << buf;
+    out << "  \"step_histogram\": [";
+    for (uint32_t b = 0; b < RENDER_STATS_COUNTERS - 4; b++) {
+        out << (b ? ", " : "") << s.stepHistogram[b];
+    }
+    out << "]\n}\n";
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        std::snprintf(buf, sizeof(buf), "render stats: %llu rays, %.1f steps per ray, written to %s\n",
+                      static_cast<unsigned long long>(s.rays), static_cast<double>(s.coarseSteps + s.fineSteps) / rays,
+                      options.renderStatsOutput.c_str());
+        gLogFile << buf;
+        gLogFile.flush();
+    }
+}
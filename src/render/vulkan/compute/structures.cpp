@@ -0,0 +1,273 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+// The prefab structures the raymarch places on the terrain are voxel models
+// built here at startup and packed into a brick atlas: every model is cut into
+// 8x8x8 bricks, empty bricks cost one table word and identical bricks (the
+// repeated legs, beams and pipe runs) are stored once. Placement is procedural
+// in the shader, so thousands of structures share these few kilobytes. The
+// layout must match shaders/world/structures.glsl.
+
+static const uint32_t STRUCTURE_BRICK = 8;
+static const uint32_t STRUCTURE_BRICK_WORDS = STRUCTURE_BRICK * STRUCTURE_BRICK * STRUCTURE_BRICK * 2 / 32;
+static const uint32_t STRUCTURE_HEADER_WORDS = 4;
+static const uint32_t STRUCTURE_EMPTY_BRICK = 0xFFFFFFFFu;
+
+// Voxel parts, as PART_* in shaders/rendering/materials.glsl.
+static const uint8_t PART_FRAME = 1;
+static const uint8_t PART_PIPE = 2;
+static const uint8_t PART_GRATING = 3;
+
+struct Prefab {
+    uint32_t size[3];
+    std::vector<uint8_t> parts;
+
+    Prefab(uint32_t x, uint32_t y, uint32_t z) : size{ x, y, z }, parts(static_cast<size_t>(x) * y * z, 0) {}
+
+    uint8_t at(uint32_t x, uint32_t y, uint32_t z) const {
+        return parts[x + size[0] * (y + static_cast<size_t>(size[1]) * z)];
+    }
+
+    void set(int x, int y, int z, uint8_t part) {
+        if (x < 0 || y < 0 || z < 0 || x >= static_cast<int>(size[0]) || y >= static_cast<int>(size[1]) ||
+            z >= static_cast<int>(size[2])) {
+            return;
+        }
+        parts[x + size[0] * (y + static_cast<size_t>(size[1]) * z)] = part;
+    }
+
+    // Fills [x0, x1) x [y0, y1) x [z0, z1).
+    void box(int x0, int y0, int z0, int x1, int y1, int z1, uint8_t part) {
+        for (int z = z0; z < z1; z++) {
+            for (int y = y0; y < y1; y++) {
+                for (int x = x0; x < x1; x++) set(x, y, z, part);
+            }
+        }
+    }
+};
+
+// Two pipes along x on a row of portal frames.
+static Prefab pipeRack() {
+    Prefab p(40, 12, 7);
+    for (int x : { 0, 8, 16, 24, 32, 39 }) {
+        p.box(x, 0, 0, x + 1, 10, 1, PART_FRAME);
+        p.box(x, 0, 6, x + 1, 10, 7, PART_FRAME);
+        p.box(x, 9, 0, x + 1, 10, 7, PART_FRAME);
+    }
+    p.box(0, 9, 0, 40, 10, 1, PART_FRAME);
+    p.box(0, 9, 6, 40, 10, 7, PART_FRAME);
+    p.box(0, 10, 1, 40, 12, 3, PART_PIPE);
+    p.box(0, 10, 4, 40, 12, 6, PART_PIPE);
+    return p;
+}
+
+// A braced lattice tower with a platform halfway, a railed top and a stack
+// up the middle.
+static Prefab tower() {
+    Prefab p(9, 44, 9);
+    for (int c : { 0, 8 }) {
+        p.box(c, 0, 0, c + 1, 41, 1, PART_FRAME);
+        p.box(c, 0, 8, c + 1, 41, 9, PART_FRAME);
+    }
+    for (int y = 8; y <= 40; y += 8) {
+        p.box(0, y, 0, 9, y + 1, 1, PART_FRAME);
+        p.box(0, y, 8, 9, y + 1, 9, PART_FRAME);
+        p.box(0, y, 0, 1, y + 1, 9, PART_FRAME);
+        p.box(8, y, 0, 9, y + 1, 9, PART_FRAME);
+    }
+    for (int y0 = 0; y0 < 40; y0 += 8) {
+        bool flip = (y0 / 8) % 2 != 0;
+        for (int i = 0; i <= 8; i++) {
+            int a = flip ? 8 - i : i;
+            p.set(a, y0 + i, 0, PART_FRAME);
+            p.set(a, y0 + i, 8, PART_FRAME);
+            p.set(0, y0 + i, a, PART_FRAME);
+            p.set(8, y0 + i, a, PART_FRAME);
+        }
+    }
+    p.box(1, 20, 1, 8, 21, 8, PART_GRATING);
+    p.box(1, 40, 1, 8, 41, 8, PART_GRATING);
+    for (int c : { 0, 4, 8 }) {
+        p.box(c, 41, 0, c + 1, 43, 1, PART_FRAME);
+        p.box(c, 41, 8, c + 1, 43, 9, PART_FRAME);
+        p.box(0, 41, c, 1, 43, c + 1, PART_FRAME);
+        p.box(8, 41, c, 9, 43, c + 1, PART_FRAME);
+    }
+    p.box(0, 42, 0, 9, 43, 1, PART_FRAME);
+    p.box(0, 42, 8, 9, 43, 9, PART_FRAME);
+    p.box(0, 42, 0, 1, 43, 9, PART_FRAME);
+    p.box(8, 42, 0, 9, 43, 9, PART_FRAME);
+    p.box(4, 0, 4, 5, 44, 5, PART_PIPE);
+    return p;
+}
+
+// A railed grating walkway on legs with a pipe run underneath.
+static Prefab catwalk() {
+    Prefab p(36, 8, 5);
+    for (int x : { 0, 12, 24, 35 }) {
+        p.box(x, 0, 0, x + 1, 5, 1, PART_FRAME);
+        p.box(x, 0, 4, x + 1, 5, 5, PART_FRAME);
+        p.box(x, 4, 0, x + 1, 5, 5, PART_FRAME);
+    }
+    p.box(0, 3, 2, 36, 4, 3, PART_PIPE);
+    p.box(0, 5, 0, 36, 6, 5, PART_GRATING);
+    for (int x = 0; x < 36; x += 4) {
+        p.box(x, 6, 0, x + 1, 8, 1, PART_FRAME);
+        p.box(x, 6, 4, x + 1, 8, 5, PART_FRAME);
+    }
+    p.box(0, 7, 0, 36, 8, 1, PART_FRAME);
+    p.box(0, 7, 4, 36, 8, 5, PART_FRAME);
+    return p;
+}
+
+// A closed cylindrical tank with a vent on the roof and an outlet pipe.
+static Prefab tank() {
+    Prefab p(15, 17, 15);
+    for (int z = 0; z < 15; z++) {
+        for (int x = 0; x < 15; x++) {
+            float d = std::hypot(static_cast<float>(x) - 7.0f, static_cast<float>(z) - 7.0f);
+            if (d >= 7.2f) continue;
+            if (d >= 6.0f) p.box(x, 0, z, x + 1, 14, z + 1, PART_FRAME);
+            p.set(x, 14, z, PART_FRAME);
+        }
+    }
+    p.box(7, 15, 7, 8, 17, 8, PART_PIPE);
+    p.box(7, 1, 6, 15, 3, 8, PART_PIPE);
+    return p;
+}
+
+void VulkanAppImpl::createStructureAtlas() {
+    std::vector<Prefab> prefabs = { pipeRack(), tower(), catwalk(), tank() };
+
+    std::vector<uint32_t> words(STRUCTURE_HEADER_WORDS + 4 * prefabs.size(), 0);
+    words[0] = static_cast<uint32_t>(prefabs.size());
+    std::map<std::array<uint32_t, STRUCTURE_BRICK_WORDS>, uint32_t> stored;
+    uint32_t bricks = 0;
+    uint32_t emptyBricks = 0;
+
+    for (size_t m = 0; m < prefabs.size(); m++) {
+        const Prefab& p = prefabs[m];
+        if (p.size[1] > STRUCTURE_MAX_HEIGHT || p.size[0] > STRUCTURE_MAX_FOOTPRINT ||
+            p.size[2] > STRUCTURE_MAX_FOOTPRINT) {
+            throw std::runtime_error("Failed to build structure atlas: prefab exceeds the structure bounds");
+        }
+        uint32_t counts[3];
+        for (int a = 0; a < 3; a++) counts[a] = (p.size[a] + STRUCTURE_BRICK - 1) / STRUCTURE_BRICK;
+
+        uint32_t* header = &words[STRUCTURE_HEADER_WORDS + 4 * m];
+        header[0] = p.size[0];
+        header[1] = p.size[1];
+        header[2] = p.size[2];
+        uint32_t table = static_cast<uint32_t>(words.size());
+        words[STRUCTURE_HEADER_WORDS + 4 * m + 3] = table;
+        words.resize(words.size() + counts[0] * counts[1] * counts[2], STRUCTURE_EMPTY_BRICK);
+
+        for (uint32_t bz = 0; bz < counts[2]; bz++) {
+            for (uint32_t by = 0; by < counts[1]; by++) {
+                for (uint32_t bx = 0; bx < counts[0]; bx++) {
+                    std::array<uint32_t, STRUCTURE_BRICK_WORDS> brick{};
+                    bool empty = true;
+                    for (uint32_t z = 0; z < STRUCTURE_BRICK; z++) {
+                        for (uint32_t y = 0; y < STRUCTURE_BRICK; y++) {
+                            for (uint32_t x = 0; x < STRUCTURE_BRICK; x++) {
+                                uint32_t vx = bx * STRUCTURE_BRICK + x;
+                                uint32_t vy = by * STRUCTURE_BRICK + y;
+                                uint32_t vz = bz * STRUCTURE_BRICK + z;
+                                if (vx >= p.size[0] || vy >= p.size[1] || vz >= p.size[2]) continue;
+                                uint32_t part = p.at(vx, vy, vz);
+                                if (part == 0) continue;
+                                uint32_t bit = x + STRUCTURE_BRICK * (y + STRUCTURE_BRICK * z);
+                                brick[bit >> 4] |= part << (2 * (bit & 15));
+                                empty = false;
+                            }
+                        }
+                    }
+                    bricks++;
+                    if (empty) {
+                        emptyBricks++;
+                        continue;
+                    }
+                    auto found = stored.find(brick);
+                    uint32_t offset;
+                    if (found != stored.end()) {
+                        offset = found->second;
+                    } else {
+                        offset = static_cast<uint32_t>(words.size());
+                        words.insert(words.end(), brick.begin(), brick.end());
+                        stored.emplace(brick, offset);
+                    }
+                    words[table + bx + counts[0] * (by + counts[1] * bz)] = offset;
+                }
+            }
+        }
+    }
+
+    VkDeviceSize size = words.size() * sizeof(uint32_t);
+    VkBufferCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.size = size;
+    info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &info, gVkAllocator, &structureAtlasBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create structure atlas buffer");
+    }
+
+    VkMemoryRequirements req{};
+    vkGetBufferMemoryRequirements(device, structureAtlasBuffer, &req);
+
+    // Written once and read by every fine step near a structure: device-local
+    // memory the host can map when there is any, plain host memory otherwise.
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+    VkMemoryPropertyFlags required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    uint32_t typeIndex = UINT32_MAX;
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount && typeIndex == UINT32_MAX; i++) {
+        VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+        if ((req.memoryTypeBits & (1u << i)) && (flags & required) == required && (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+            typeIndex = i;
+        }
+    }
+    if (typeIndex == UINT32_MAX) typeIndex = findMemoryType(req.memoryTypeBits, required);
+
+    VkMemoryAllocateInfo alloc{};
+    alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = typeIndex;
+
+    if (memoryTracker.allocate(alloc, &structureAtlasMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate structure atlas memory");
+    }
+    vkBindBufferMemory(device, structureAtlasBuffer, structureAtlasMemory, 0);
+
+    void* mapped = nullptr;
+    if (vkMapMemory(device, structureAtlasMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to map structure atlas memory");
+    }
+    std::memcpy(mapped, words.data(), static_cast<size_t>(size));
+    vkUnmapMemory(device, structureAtlasMemory);
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        char line[192];
+        std::snprintf(line, sizeof(line),
+                      "structures: %zu prefabs, %u bricks (%u empty, %zu stored), %.1f KiB atlas, density %.2f\n",
+                      prefabs.size(), bricks, emptyBricks, stored.size(), static_cast<double>(size) / 1024.0,
+                      options.structureDensity);
+        gLogFile << line;
+        gLogFile.flush();
+    }
+}
+
+void VulkanAppImpl::destroyStructureAtlas() {
+    vkDestroyBuffer(device, structureAtlasBuffer, gVkAllocator);
+    memoryTracker.free(structureAtlasMemory);
+    structureAtlasBuffer = VK_NULL_HANDLE;
+    structureAtlasMemory = VK_NULL_HANDLE;
+}
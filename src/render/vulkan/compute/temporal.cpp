@@ -0,0 +1,44 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <stdexcept>
+
+// Temporal anti-aliasing: the raymarch traces one ray per trace block, at a
+// jittered position (jitter) or at a different pixel of the block each frame
+// (interleaved), and resolves every pixel against the previous frame's result,
+// reprojected with the camera that produced it. The history alternates between
+// the two layers of the history image.
+
+void VulkanAppImpl::initTemporal() {
+    traceBlock = RAYMARCH_UPSCALE;
+    if (options.temporalMode == "off") {
+        temporalMode = TEMPORAL_OFF;
+    } else if (options.temporalMode == "jitter") {
+        temporalMode = TEMPORAL_JITTER;
+    } else if (options.temporalMode == "interleaved") {
+        temporalMode = TEMPORAL_INTERLEAVED;
+    } else if (options.temporalMode == "interleaved16") {
+        temporalMode = TEMPORAL_INTERLEAVED;
+        traceBlock = INTERLEAVED16_BLOCK;
+    } else {
+        throw std::runtime_error("Unknown temporal anti-aliasing mode: " + options.temporalMode);
+    }
+}
+
+bool VulkanAppImpl::historyWritten() const {
+    return refineSamples > 0 || temporalMode != TEMPORAL_OFF;
+}
+
+// Called once the frame is recorded: what it wrote becomes the history the
+// next frame reprojects from. The cameras are kept either way since the far
+// layer reprojects with them too.
+void VulkanAppImpl::advanceHistory() {
+    metrics.frames->add();
+    if (historyValid) metrics.historyReused->add();
+    historyViews = renderViews;
+    if (!historyWritten()) {
+        historyValid = false;
+        return;
+    }
+    historyLayer ^= 1;
+    historyValid = true;
+}
@@ -0,0 +1,143 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+// Register counts, spills and instruction counts come from the driver via
+// VK_KHR_pipeline_executable_properties. Each pipeline is recorded under the
+// shader name it was built from so reports can be compared across changes.
+// Capturing slows pipeline creation, so it only happens for --benchmark
+// (statistics) and --pipeline-report (statistics and internal representations).
+
+VkPipelineCreateFlags VulkanAppImpl::pipelineCaptureFlags() const {
+    if (!pipelineExecutableInfoEnabled) return 0;
+    VkPipelineCreateFlags flags = VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR;
+    if (!options.pipelineReport.empty()) flags |= VK_PIPELINE_CREATE_CAPTURE_INTERNAL_REPRESENTATIONS_BIT_KHR;
+    return flags;
+}
+
+static std::string statisticValue(const VkPipelineExecutableStatisticKHR& stat) {
+    char buf[64];
+    switch (stat.format) {
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_BOOL32_KHR:
+        return stat.value.b32 ? "true" : "false";
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_INT64_KHR:
+        std::snprintf(buf, sizeof(buf), "%" PRId64, stat.value.i64);
+        return buf;
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_UINT64_KHR:
+        std::snprintf(buf, sizeof(buf), "%" PRIu64, stat.value.u64);
+        return buf;
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_FLOAT64_KHR:
+        std::snprintf(buf, sizeof(buf), "%.3f", stat.value.f64);
+        return buf;
+    }
+    return "0";
+}
+
+void VulkanAppImpl::capturePipelineStatistics(VkPipeline pipeline, const char* name) {
+    if (!pipelineExecutableInfoEnabled) return;
+
+    auto getProperties = reinterpret_cast<PFN_vkGetPipelineExecutablePropertiesKHR>(
+        vkGetDeviceProcAddr(device, "vkGetPipelineExecutablePropertiesKHR"));
+    auto getStatistics = reinterpret_cast<PFN_vkGetPipelineExecutableStatisticsKHR>(
+        vkGetDeviceProcAddr(device, "vkGetPipelineExecutableStatisticsKHR"));
+    auto getRepresentations = reinterpret_cast<PFN_vkGetPipelineExecutableInternalRepresentationsKHR>(
+        vkGetDeviceProcAddr(device, "vkGetPipelineExecutableInternalRepresentationsKHR"));
+    if (!getProperties || !getStatistics || !getRepresentations) return;
+
+    PipelineReport report;
+    report.name = name;
+
+    VkPipelineInfoKHR pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INFO_KHR;
+    pipelineInfo.pipeline = pipeline;
+
+    uint32_t executableCount = 0;
+    getProperties(device, &pipelineInfo, &executableCount, nullptr);
+    std::vector<VkPipelineExecutablePropertiesKHR> executables(executableCount);
+    for (auto& e : executables) e.sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_PROPERTIES_KHR;
+    getProperties(device, &pipelineInfo, &executableCount, executables.data());
+
+    for (uint32_t i = 0; i < executableCount; i++) {
+        PipelineExecutableReport exec;
+        exec.name = executables[i].name;
+        exec.description = executables[i].description;
+        exec.subgroupSize = executables[i].subgroupSize;
+
+        VkPipelineExecutableInfoKHR execInfo{};
+        execInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_INFO_KHR;
+        execInfo.pipeline = pipeline;
+        execInfo.executableIndex = i;
+
+        uint32_t statCount = 0;
+        getStatistics(device, &execInfo, &statCount, nullptr);
+        std::vector<VkPipelineExecutableStatisticKHR> stats(statCount);
+        for (auto& s : stats) s.sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_STATISTIC_KHR;
+        getStatistics(device, &execInfo, &statCount, stats.data());
+        for (const auto& s : stats) {
+            exec.statistics.push_back({ s.name, s.description, statisticValue(s) });
+        }
+
+        if (options.pipelineReport.empty()) {
+            report.executables.push_back(std::move(exec));
+            continue;
+        }
+
+        // Count, then sizes (pData null), then the text itself.
+        uint32_t irCount = 0;
+        getRepresentations(device, &execInfo, &irCount, nullptr);
+        std::vector<VkPipelineExecutableInternalRepresentationKHR> irs(irCount);
+        for (auto& ir : irs) ir.sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_INTERNAL_REPRESENTATION_KHR;
+        getRepresentations(device, &execInfo, &irCount, irs.data());
+        std::vector<std::vector<char>> irData(irCount);
+        for (uint32_t r = 0; r < irCount; r++) {
+            irData[r].resize(irs[r].dataSize + 1, '\0');
+            irs[r].pData = irData[r].data();
+        }
+        getRepresentations(device, &execInfo, &irCount, irs.data());
+        for (uint32_t r = 0; r < irCount; r++) {
+            if (!irs[r].isText) continue;
+            exec.representations.push_back({ irs[r].name, std::string(irData[r].data()) });
+        }
+
+        report.executables.push_back(std::move(exec));
+    }
+
+    // Pipelines are compiled on worker threads at startup.
+    std::lock_guard<std::mutex> lock(pipelineReportMutex);
+    pipelineReports.push_back(std::move(report));
+}
+
+void VulkanAppImpl::writePipelineReport() {
+    if (pipelineReports.empty() || options.pipelineReport.empty()) return;
+
+    std::ofstream out(options.pipelineReport, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) return;
+
+    std::sort(pipelineReports.begin(), pipelineReports.end(),
+              [](const PipelineReport& a, const PipelineReport& b) { return a.name < b.name; });
+
+    for (const auto& report : pipelineReports) {
+        for (const auto& exec : report.executables) {
+            out << "== " << report.name << " / " << exec.name << " (subgroup " << exec.subgroupSize << ")\n";
+            out << exec.description << "\n";
+            for (const auto& stat : exec.statistics) {
+                out << "  " << stat.name << ": " << stat.value << "\n";
+            }
+            for (const auto& [irName, text] : exec.representations) {
+                out << "-- " << irName << "\n" << text << "\n";
+            }
+            out << "\n";
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        gLogFile << "pipeline statistics for " << pipelineReports.size() << " pipelines written to "
+                 << options.pipelineReport << '\n';
+        gLogFile.flush();
+    }
+}
@@ -13,11 +13,30 @@ VkSurfaceFormatKHR VulkanAppImpl::chooseSwapSurfaceFormat(const std::vector<VkSu
     return availableFormats[0];
 }
 
+static const char* presentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+    case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+    default: return "other";
+    }
+}
+
+// FIFO is the only mode every driver has to support, so it is the fallback
+// when the requested one is missing.
 VkPresentModeKHR VulkanAppImpl::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
+    VkPresentModeKHR chosen = VK_PRESENT_MODE_FIFO_KHR;
     for (const auto& mode : availablePresentModes) {
-        if (mode == VK_PRESENT_MODE_MAILBOX_KHR) return mode;
+        if (options.presentMode == presentModeName(mode)) chosen = mode;
+    }
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        gLogFile << "present mode: " << presentModeName(chosen) << " (requested " << options.presentMode << ")\n";
+        gLogFile.flush();
     }
-    return VK_PRESENT_MODE_FIFO_KHR;
+    return chosen;
 }
 
 VkExtent2D VulkanAppImpl::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
@@ -34,6 +53,7 @@ void VulkanAppImpl::createSwapchain() {
     SwapchainSupportDetails support = querySwapchainSupport(physicalDevice);
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(support.formats);
     VkPresentModeKHR presentMode = chooseSwapPresentMode(support.presentModes);
+    presentModeLabel = presentModeName(presentMode);
     VkExtent2D extent = chooseSwapExtent(support.capabilities);
 
     uint32_t imageCount = support.capabilities.minImageCount + 1;
@@ -50,6 +70,10 @@ void VulkanAppImpl::createSwapchain() {
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_STORAGE_BIT;
+    captureSupported = (support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+    if (!options.captureOutput.empty() && captureSupported) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
 
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
     uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
@@ -68,7 +92,7 @@ void VulkanAppImpl::createSwapchain() {
     createInfo.clipped = VK_TRUE;
     createInfo.oldSwapchain = VK_NULL_HANDLE;
 
-    if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain) != VK_SUCCESS) {
+    if (vkCreateSwapchainKHR(device, &createInfo, gVkAllocator, &swapchain) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create swapchain");
     }
 
@@ -99,9 +123,70 @@ void VulkanAppImpl::createImageViews() {
         createInfo.subresourceRange.baseArrayLayer = 0;
         createInfo.subresourceRange.layerCount = 1;
 
-        if (vkCreateImageView(device, &createInfo, nullptr, &swapchainImageViews[i]) != VK_SUCCESS) {
+        if (vkCreateImageView(device, &createInfo, gVkAllocator, &swapchainImageViews[i]) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create image view");
         }
     }
 }
 
+
+// Headless runs render into a plain image that takes the place of the
+// swapchain images, sized to one screenshot tile, one batch image, the
+// largest request the render server takes or the window a replay stands in for.
+void VulkanAppImpl::createOffscreenTarget() {
+    swapchainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    if (!options.serveSocket.empty()) {
+        swapchainExtent = { options.serveWidth, options.serveHeight };
+    } else if (!options.batchCameras.empty()) {
+        swapchainExtent = { options.batchWidth, options.batchHeight };
+    } else if (!options.replayInput.empty()) {
+        swapchainExtent = { WIDTH, HEIGHT };
+    } else {
+        swapchainExtent = { std::min(options.screenshotTile, options.screenshotWidth),
+                            std::min(options.screenshotTile, options.screenshotHeight) };
+    }
+    if (swapchainExtent.width == 0 || swapchainExtent.height == 0) {
+        throw std::runtime_error("Invalid offscreen target size");
+    }
+    presentModeLabel = "offscreen";
+    captureSupported = true;
+
+    VkImageCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = swapchainImageFormat;
+    info.extent = { swapchainExtent.width, swapchainExtent.height, 1 };
+    info.mipLevels = 1;
+    info.arrayLayers = 1;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkImage image{};
+    if (vkCreateImage(device, &info, gVkAllocator, &image) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create offscreen target");
+    }
+
+    VkMemoryRequirements req{};
+    vkGetImageMemoryRequirements(device, image, &req);
+
+    VkMemoryAllocateInfo alloc{};
+    alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc.allocationSize = req.size;
+    alloc.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (memoryTracker.allocate(alloc, &offscreenMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate offscreen target memory");
+    }
+    vkBindImageMemory(device, image, offscreenMemory, 0);
+
+    swapchainImages = { image };
+    imageLayoutInitialized.assign(swapchainImages.size(), false);
+}
+
+void VulkanAppImpl::destroyOffscreenTarget() {
+    for (auto image : swapchainImages) vkDestroyImage(device, image, gVkAllocator);
+    memoryTracker.free(offscreenMemory);
+}
@@ -0,0 +1,186 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+static uint64_t timestampMask(uint32_t validBits) {
+    if (validBits == 0) return 0;
+    return validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+}
+
+// The host domain matching steady_clock, which the CPU trace uses.
+static VkTimeDomainEXT steadyClockDomain() {
+#ifdef _WIN32
+    return VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+    return VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+}
+
+static uint64_t hostTicksToNs(uint64_t ticks) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    uint64_t f = static_cast<uint64_t>(frequency.QuadPart);
+    return ticks / f * 1000000000ull + ticks % f * 1000000000ull / f;
+#else
+    return ticks;
+#endif
+}
+
+void VulkanAppImpl::createTimestampQueries() {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    timestampPeriod = props.limits.timestampPeriod;
+
+    uint32_t count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &count, families.data());
+    graphicsTimestampMask = timestampMask(families[graphicsQueueFamily].timestampValidBits);
+    computeTimestampMask = timestampMask(families[computeQueueFamily].timestampValidBits);
+    if (graphicsTimestampMask == 0 || timestampPeriod <= 0.0f) return;
+
+    VkQueryPoolCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    info.queryCount = TS_COUNT;
+
+    if (vkCreateQueryPool(device, &info, gVkAllocator, &timestampPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timestamp query pool");
+    }
+
+    if (!calibratedTimestampsEnabled) {
+        if (!options.traceOutput.empty()) {
+            std::lock_guard<std::mutex> lock(gLogMutex);
+            if (gLogFile.is_open()) gLogFile << "trace: no VK_EXT_calibrated_timestamps, GPU tracks left out\n";
+        }
+        return;
+    }
+    auto getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+    uint32_t domainCount = 0;
+    if (getTimeDomains) getTimeDomains(physicalDevice, &domainCount, nullptr);
+    std::vector<VkTimeDomainEXT> domains(domainCount);
+    if (domainCount > 0) getTimeDomains(physicalDevice, &domainCount, domains.data());
+    bool deviceDomain = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+    bool hostDomain = std::find(domains.begin(), domains.end(), steadyClockDomain()) != domains.end();
+    if (!deviceDomain || !hostDomain) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) {
+            gLogFile << "timestamps: device cannot calibrate against the host clock, GPU trace tracks and queue overlap left out\n";
+        }
+        return;
+    }
+    hostTimeDomain = steadyClockDomain();
+    getCalibratedTimestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(
+        vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT"));
+    calibrateGpuClock();
+}
+
+// One device/host timestamp pair maps GPU ticks onto the trace clock. It is
+// refreshed every CLOCK_CALIBRATION_NS so drift between the clocks stays far
+// below a microsecond. The device domain is shared by every queue, so ranges
+// from the graphics and compute queues can be compared once converted.
+void VulkanAppImpl::calibrateGpuClock() {
+    if (!getCalibratedTimestamps) return;
+    VkCalibratedTimestampInfoEXT infos[2]{};
+    infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[1].timeDomain = hostTimeDomain;
+
+    uint64_t ts[2]{};
+    uint64_t maxDeviation = 0;
+    if (getCalibratedTimestamps(device, 2, infos, ts, &maxDeviation) != VK_SUCCESS) return;
+    gpuCalibrationTicks = ts[0];
+    hostCalibrationNs = hostTicksToNs(ts[1]);
+    lastCalibrationNs = profilerNow();
+}
+
+// `mask` holds the valid bits of the queue that wrote `ticks`; the distance to
+// the calibration point is taken modulo it, so a queue with fewer valid bits
+// still lands on the same clock.
+uint64_t VulkanAppImpl::gpuToTraceNs(uint64_t ticks, uint64_t mask) const {
+    uint64_t diff = (ticks - gpuCalibrationTicks) & mask;
+    int64_t ticksFromCalibration = diff > (mask >> 1) ? -static_cast<int64_t>(mask - diff) - 1 : static_cast<int64_t>(diff);
+    double delta = static_cast<double>(ticksFromCalibration) * timestampPeriod;
+    return static_cast<uint64_t>(static_cast<int64_t>(hostCalibrationNs) + static_cast<int64_t>(delta));
+}
+
+void VulkanAppImpl::collectGpuTimings() {
+    if (!timestampPool) return;
+    auto toMs = [this](uint64_t ticks) { return static_cast<double>(ticks) * timestampPeriod * 1e-6; };
+    bool calibrated = getCalibratedTimestamps != nullptr;
+    bool trace = calibrated && gProfilerEnabled.load(std::memory_order_relaxed);
+    if (calibrated && profilerNow() - lastCalibrationNs >= CLOCK_CALIBRATION_NS) calibrateGpuClock();
+    // The queries read here were written by the last frame the recorder committed.
+    FrameRecord* record = lastFrameRecord();
+
+    if (raymarchQueriesWritten) {
+        uint64_t ts[2]{};
+        if (vkGetQueryPoolResults(device, timestampPool, TS_RAYMARCH_BEGIN, 2, sizeof(ts), ts,
+                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            uint64_t begin = ts[0] & graphicsTimestampMask;
+            uint64_t end = ts[1] & graphicsTimestampMask;
+            gpuTimings.raymarchMs += toMs(end - begin);
+            gpuTimings.frames += 1;
+            if (benchmarkRecording) benchmarkStats.raymarchMs.push_back(toMs(end - begin));
+            metrics.raymarchMs->observe(toMs(end - begin));
+            if (record) record->gpuRaymarchMs = toMs(end - begin);
+            if (renderStatsMapped) renderStats.raymarchMs.push_back(toMs(end - begin));
+            if (calibrated) {
+                uint64_t beginNs = gpuToTraceNs(begin, graphicsTimestampMask);
+                uint64_t endNs = gpuToTraceNs(end, graphicsTimestampMask);
+                if (trace) profileGpuEvent("graphics queue", "raymarch", beginNs, endNs);
+                uint32_t slot = raymarchHistoryCount % 8;
+                raymarchHistory[slot][0] = beginNs;
+                raymarchHistory[slot][1] = endNs;
+                raymarchHistoryCount += 1;
+            }
+        }
+        raymarchQueriesWritten = false;
+    }
+
+    if (heightCacheQueriesWritten) {
+        uint64_t ts[2]{};
+        if (vkGetQueryPoolResults(device, timestampPool, TS_HEIGHT_CACHE_BEGIN, 2, sizeof(ts), ts,
+                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+            return;
+        }
+        uint64_t mask = heightCacheQueriesAsync ? computeTimestampMask : graphicsTimestampMask;
+        uint64_t begin = ts[0] & mask;
+        uint64_t end = ts[1] & mask;
+        gpuTimings.heightCacheMs += toMs(end - begin);
+        gpuTimings.heightCacheUpdates += 1;
+        metrics.heightCacheMs->observe(toMs(end - begin));
+        if (record) record->gpuHeightCacheMs = toMs(end - begin);
+        if (calibrated) {
+            uint64_t beginNs = gpuToTraceNs(begin, mask);
+            uint64_t endNs = gpuToTraceNs(end, mask);
+            if (trace) {
+                profileGpuEvent(heightCacheQueriesAsync ? "compute queue" : "graphics queue", "height cache update",
+                                beginNs, endNs);
+            }
+            // Time the update spent running concurrently with recent raymarch dispatches.
+            uint32_t n = std::min(raymarchHistoryCount, 8u);
+            for (uint32_t i = 0; i < n; ++i) {
+                uint64_t lo = std::max(beginNs, raymarchHistory[i][0]);
+                uint64_t hi = std::min(endNs, raymarchHistory[i][1]);
+                if (hi > lo) gpuTimings.overlapMs += static_cast<double>(hi - lo) * 1e-6;
+            }
+            gpuTimings.overlapUpdates += 1;
+        }
+        if (benchmarkRecording) {
+            benchmarkStats.heightCacheMs += toMs(end - begin);
+            benchmarkStats.heightCacheUpdates += 1;
+        }
+        heightCacheQueriesWritten = false;
+    }
+}
@@ -1,6 +1,7 @@
 #include "render/vulkan/app/vulkan_app_impl.hpp"
 
 #include <vector>
+#include <algorithm>
 #include <set>
 #include <cstring>
 #include <stdexcept>
@@ -10,7 +11,14 @@ static const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Device selection, device creation and swapchain creation all ask the same
+// questions about the same devices; the answers do not change while the app
+// runs, so each is queried once per device.
+
 QueueFamilyIndices VulkanAppImpl::findQueueFamilies(VkPhysicalDevice dev) {
+    auto cached = queueFamilyCache.find(dev);
+    if (cached != queueFamilyCache.end()) return cached->second;
+
     QueueFamilyIndices indices;
     uint32_t count = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(dev, &count, nullptr);
@@ -18,33 +26,68 @@ QueueFamilyIndices VulkanAppImpl::findQueueFamilies(VkPhysicalDevice dev) {
     vkGetPhysicalDeviceQueueFamilyProperties(dev, &count, families.data());
     uint32_t i = 0;
     for (const auto& f : families) {
-        if (f.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
+        if (!indices.isComplete()) {
+            if (f.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                indices.graphicsFamily = i;
+            }
+            // Without a surface nothing is presented; the graphics family
+            // stands in so the rest of device setup is unchanged.
+            VkBool32 presentSupport = VK_FALSE;
+            if (surface) {
+                vkGetPhysicalDeviceSurfaceSupportKHR(dev, i, surface, &presentSupport);
+            } else {
+                presentSupport = (f.queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+            }
+            if (presentSupport) {
+                indices.presentFamily = i;
+            }
         }
-        VkBool32 presentSupport = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(dev, i, surface, &presentSupport);
-        if (presentSupport) {
-            indices.presentFamily = i;
+        bool graphics = (f.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        bool compute = (f.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+        if (compute && !graphics && !indices.computeFamily) {
+            indices.computeFamily = i;
         }
-        if (indices.isComplete()) break;
         ++i;
     }
+    queueFamilyCache[dev] = indices;
     return indices;
 }
 
-bool VulkanAppImpl::checkDeviceExtensionSupport(VkPhysicalDevice dev) {
+const std::vector<VkExtensionProperties>& VulkanAppImpl::deviceExtensionProperties(VkPhysicalDevice dev) {
+    auto cached = deviceExtensionCache.find(dev);
+    if (cached != deviceExtensionCache.end()) return cached->second;
+
     uint32_t count;
     vkEnumerateDeviceExtensionProperties(dev, nullptr, &count, nullptr);
     std::vector<VkExtensionProperties> available(count);
     vkEnumerateDeviceExtensionProperties(dev, nullptr, &count, available.data());
+    return deviceExtensionCache[dev] = std::move(available);
+}
+
+bool VulkanAppImpl::checkDeviceExtensionSupport(VkPhysicalDevice dev) {
     std::set<std::string> required(deviceExtensions.begin(), deviceExtensions.end());
-    for (const auto& ext : available) {
+    for (const auto& ext : deviceExtensionProperties(dev)) {
         required.erase(ext.extensionName);
     }
     return required.empty();
 }
 
+bool VulkanAppImpl::hasDeviceExtension(VkPhysicalDevice dev, const char* name) {
+    for (const auto& ext : deviceExtensionProperties(dev)) {
+        if (std::strcmp(ext.extensionName, name) == 0) return true;
+    }
+    return false;
+}
+
+// Capabilities carry the current surface extent and are always re-queried.
 SwapchainSupportDetails VulkanAppImpl::querySwapchainSupport(VkPhysicalDevice dev) {
+    auto cached = swapchainSupportCache.find(dev);
+    if (cached != swapchainSupportCache.end()) {
+        SwapchainSupportDetails details = cached->second;
+        vkGetPhysicalDeviceSurfaceCapabilitiesKHR(dev, surface, &details.capabilities);
+        return details;
+    }
+
     SwapchainSupportDetails details{};
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(dev, surface, &details.capabilities);
     uint32_t count;
@@ -58,11 +101,13 @@ SwapchainSupportDetails VulkanAppImpl::querySwapchainSupport(VkPhysicalDevice de
         details.presentModes.resize(count);
         vkGetPhysicalDeviceSurfacePresentModesKHR(dev, surface, &count, details.presentModes.data());
     }
+    swapchainSupportCache[dev] = details;
     return details;
 }
 
 bool VulkanAppImpl::isDeviceSuitable(VkPhysicalDevice dev) {
     QueueFamilyIndices indices = findQueueFamilies(dev);
+    if (headless()) return indices.isComplete();
     bool extensionsSupported = checkDeviceExtensionSupport(dev);
     bool swapchainAdequate = false;
     if (extensionsSupported) {
@@ -99,22 +144,23 @@ void VulkanAppImpl::pickPhysicalDevice() {
     if (deviceCount == 0) throw std::runtime_error("No Vulkan devices found");
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
-    uint64_t bestScore = 0;
+    std::vector<std::pair<uint64_t, VkPhysicalDevice>> suitable;
     for (const auto& dev : devices) {
-        if (!isDeviceSuitable(dev)) continue;
-        uint64_t score = rateDevice(dev);
-        if (score > bestScore) {
-            bestScore = score;
-            physicalDevice = dev;
-        }
+        if (isDeviceSuitable(dev)) suitable.push_back({ rateDevice(dev), dev });
     }
-    if (!physicalDevice) throw std::runtime_error("No suitable GPU found");
+    if (suitable.empty()) throw std::runtime_error("No suitable GPU found");
+    std::stable_sort(suitable.begin(), suitable.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    // Batch shards take the suitable devices in turn, best first.
+    size_t pick = options.shardIndex > 0 ? static_cast<size_t>(options.shardIndex) % suitable.size() : 0;
+    physicalDevice = suitable[pick].second;
 }
 
 void VulkanAppImpl::createLogicalDevice() {
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
     std::vector<VkDeviceQueueCreateInfo> queueInfos;
     std::set<uint32_t> uniqueQueues = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    if (indices.computeFamily) uniqueQueues.insert(indices.computeFamily.value());
     float priority = 1.0f;
     for (uint32_t q : uniqueQueues) {
         VkDeviceQueueCreateInfo info{};
@@ -127,20 +173,151 @@ void VulkanAppImpl::createLogicalDevice() {
 
     VkPhysicalDeviceFeatures features{};
 
+    // Timeline semaphores are core in 1.2 but still optional on some drivers.
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    VkPhysicalDeviceVulkan12Features features12{};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+    bool vulkan12 = props.apiVersion >= VK_API_VERSION_1_2;
+    if (vulkan12) {
+        VkPhysicalDeviceVulkan12Features supported12{};
+        supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+        VkPhysicalDeviceFeatures2 supported{};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported.pNext = &supported12;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+        features12.timelineSemaphore = supported12.timelineSemaphore;
+    }
+    timelineSemaphoreSupported = features12.timelineSemaphore == VK_TRUE;
+
+    std::vector<const char*> extensions;
+    if (!headless()) extensions = deviceExtensions;
+    void* featureChain = vulkan12 ? &features12 : nullptr;
+
+    // Render graph barriers use synchronization2 when available and fall back
+    // to vkCmdPipelineBarrier otherwise.
+    VkPhysicalDeviceSynchronization2FeaturesKHR sync2Features{};
+    sync2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    if (vulkan12 && hasDeviceExtension(physicalDevice, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 supported{};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported.pNext = &sync2Features;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+        if (sync2Features.synchronization2) {
+            extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+            sync2Features.pNext = featureChain;
+            featureChain = &sync2Features;
+        }
+    }
+
+    // Lets the driver report register usage, spills and ISA for every pipeline,
+    // when a benchmark or pipeline report asks for them.
+    VkPhysicalDevicePipelineExecutablePropertiesFeaturesKHR executableFeatures{};
+    executableFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PIPELINE_EXECUTABLE_PROPERTIES_FEATURES_KHR;
+    bool wantExecutableInfo = options.benchmark || !options.pipelineReport.empty();
+    if (wantExecutableInfo && vulkan12 && hasDeviceExtension(physicalDevice, VK_KHR_PIPELINE_EXECUTABLE_PROPERTIES_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 supported{};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported.pNext = &executableFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+        if (executableFeatures.pipelineExecutableInfo) {
+            extensions.push_back(VK_KHR_PIPELINE_EXECUTABLE_PROPERTIES_EXTENSION_NAME);
+            executableFeatures.pNext = featureChain;
+            featureChain = &executableFeatures;
+        }
+    }
+    pipelineExecutableInfoEnabled = executableFeatures.pipelineExecutableInfo == VK_TRUE;
+
+    // Present ids let the frame loop wait until the previous frame is actually
+    // on screen before sampling input, and timestamp when that happened.
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    if (vulkan12 && !headless() && hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        VkPhysicalDeviceFeatures2 supported{};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+        if (presentIdFeatures.presentId && presentWaitFeatures.presentWait) {
+            extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+            extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+            presentWaitFeatures.pNext = featureChain;
+            featureChain = &presentIdFeatures;
+        } else {
+            presentIdFeatures.presentId = VK_FALSE;
+        }
+    }
+
+    // Cycle counters in the raymarch for --cost-heatmap.
+    VkPhysicalDeviceShaderClockFeaturesKHR clockFeatures{};
+    clockFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_CLOCK_FEATURES_KHR;
+    bool costRequested = !options.costHeatmapOutput.empty() || options.costOverlay;
+    if (vulkan12 && costRequested && hasDeviceExtension(physicalDevice, VK_KHR_SHADER_CLOCK_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 supported{};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported.pNext = &clockFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+        if (clockFeatures.shaderSubgroupClock) {
+            extensions.push_back(VK_KHR_SHADER_CLOCK_EXTENSION_NAME);
+            clockFeatures.shaderDeviceClock = VK_FALSE;
+            clockFeatures.pNext = featureChain;
+            featureChain = &clockFeatures;
+        }
+    }
+    costHeatmapEnabled = clockFeatures.shaderSubgroupClock == VK_TRUE;
+    if (costRequested && !costHeatmapEnabled) {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) {
+            gLogFile << "cost heatmap: VK_KHR_shader_clock not supported, disabled\n";
+            gLogFile.flush();
+        }
+    }
+
+    // Driver-side budget and usage per heap; without it the memory tracker
+    // falls back to counting its own allocations.
+    bool memoryBudget = hasDeviceExtension(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memoryBudget) extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    // Puts GPU timestamps of both queues on the CPU trace's clock, which also
+    // makes the height cache overlap with the raymarch measurable.
+    calibratedTimestampsEnabled = hasDeviceExtension(physicalDevice, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+    if (calibratedTimestampsEnabled) extensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = featureChain;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
     createInfo.pQueueCreateInfos = queueInfos.data();
     createInfo.pEnabledFeatures = &features;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
-    if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+    if (vkCreateDevice(physicalDevice, &createInfo, gVkAllocator, &device) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create logical device");
     }
 
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+    // Cache updates go to a dedicated compute family when there is one, so they
+    // can overlap the raymarch; otherwise they are recorded inline on graphics.
+    graphicsQueueFamily = indices.graphicsFamily.value();
+    computeQueueFamily = indices.computeFamily.value_or(graphicsQueueFamily);
+    asyncComputeEnabled = indices.computeFamily.has_value() && timelineSemaphoreSupported;
+    vkGetDeviceQueue(device, computeQueueFamily, 0, &computeQueue);
+
+    PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2 = nullptr;
+    if (sync2Features.synchronization2) {
+        cmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR"));
+    }
+    if (presentIdFeatures.presentId) {
+        waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+    }
+    memoryTracker.init(physicalDevice, device, memoryBudget && vulkan12);
+    frameGraph.init(device, physicalDevice, graphicsQueueFamily, computeQueueFamily, cmdPipelineBarrier2, &memoryTracker);
 }
 
 uint32_t VulkanAppImpl::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
@@ -0,0 +1,165 @@
+#include "render/vulkan/core/vk_memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+static std::atomic<uint64_t> hostBytes{0};
+static std::atomic<uint64_t> hostPeakBytes{0};
+static std::atomic<uint64_t> hostLiveAllocations{0};
+static std::atomic<uint64_t> hostTotalAllocations{0};
+static std::atomic<uint64_t> hostInternalBytes{0};
+
+// Stored right before the pointer handed to the driver.
+struct AllocationHeader {
+    void* base;
+    size_t size;
+};
+
+static void trackAllocated(size_t size) {
+    uint64_t now = hostBytes.fetch_add(size) + size;
+    uint64_t peak = hostPeakBytes.load();
+    while (now > peak && !hostPeakBytes.compare_exchange_weak(peak, now)) {}
+    hostLiveAllocations.fetch_add(1);
+    hostTotalAllocations.fetch_add(1);
+}
+
+static void* VKAPI_PTR trackedAllocation(void*, size_t size, size_t alignment, VkSystemAllocationScope) {
+    if (size == 0) return nullptr;
+    alignment = std::max(alignment, alignof(AllocationHeader));
+    char* base = static_cast<char*>(std::malloc(size + alignment + sizeof(AllocationHeader)));
+    if (!base) return nullptr;
+
+    uintptr_t user = reinterpret_cast<uintptr_t>(base) + sizeof(AllocationHeader);
+    user = (user + alignment - 1) / alignment * alignment;
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(user) - 1;
+    header->base = base;
+    header->size = size;
+    trackAllocated(size);
+    return reinterpret_cast<void*>(user);
+}
+
+static void VKAPI_PTR trackedFree(void*, void* memory) {
+    if (!memory) return;
+    AllocationHeader* header = static_cast<AllocationHeader*>(memory) - 1;
+    hostBytes.fetch_sub(header->size);
+    hostLiveAllocations.fetch_sub(1);
+    std::free(header->base);
+}
+
+static void* VKAPI_PTR trackedReallocation(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (!original) return trackedAllocation(userData, size, alignment, scope);
+    if (size == 0) {
+        trackedFree(userData, original);
+        return nullptr;
+    }
+    void* memory = trackedAllocation(userData, size, alignment, scope);
+    if (!memory) return nullptr;
+    size_t oldSize = (static_cast<AllocationHeader*>(original) - 1)->size;
+    std::memcpy(memory, original, std::min(oldSize, size));
+    trackedFree(userData, original);
+    return memory;
+}
+
+static void VKAPI_PTR trackedInternalAllocation(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope) {
+    hostInternalBytes.fetch_add(size);
+}
+
+static void VKAPI_PTR trackedInternalFree(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope) {
+    hostInternalBytes.fetch_sub(size);
+}
+
+static const VkAllocationCallbacks trackingCallbacks = {
+    nullptr,
+    trackedAllocation,
+    trackedReallocation,
+    trackedFree,
+    trackedInternalAllocation,
+    trackedInternalFree,
+};
+
+const VkAllocationCallbacks* gVkAllocator = &trackingCallbacks;
+
+HostAllocationStats hostAllocationStats() {
+    HostAllocationStats stats;
+    stats.bytes = hostBytes.load();
+    stats.peakBytes = hostPeakBytes.load();
+    stats.liveAllocations = hostLiveAllocations.load();
+    stats.totalAllocations = hostTotalAllocations.load();
+    stats.internalBytes = hostInternalBytes.load();
+    return stats;
+}
+
+void DeviceMemoryTracker::init(VkPhysicalDevice physical, VkDevice dev, bool budget) {
+    physicalDevice = physical;
+    device = dev;
+    budgetExtension = budget;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    heapStates.assign(memoryProperties.memoryHeapCount, {});
+    VkDeviceSize largest = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        heapStates[i].size = memoryProperties.memoryHeaps[i].size;
+        heapStates[i].deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        if (heapStates[i].deviceLocal && heapStates[i].size > largest) {
+            largest = heapStates[i].size;
+            primaryDeviceHeap = i;
+        }
+    }
+    refresh();
+}
+
+VkResult DeviceMemoryTracker::allocate(const VkMemoryAllocateInfo& info, VkDeviceMemory* memory) {
+    VkResult result = vkAllocateMemory(device, &info, gVkAllocator, memory);
+    if (result != VK_SUCCESS) return result;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t heap = memoryProperties.memoryTypes[info.memoryTypeIndex].heapIndex;
+    allocations[*memory] = { heap, info.allocationSize };
+    heapStates[heap].trackedUsage += info.allocationSize;
+    return result;
+}
+
+void DeviceMemoryTracker::free(VkDeviceMemory memory) {
+    if (!memory) return;
+    vkFreeMemory(device, memory, gVkAllocator);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = allocations.find(memory);
+    if (it == allocations.end()) return;
+    heapStates[it->second.first].trackedUsage -= it->second.second;
+    allocations.erase(it);
+}
+
+void DeviceMemoryTracker::refresh() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (budgetExtension) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+        budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 props{};
+        props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        props.pNext = &budget;
+        vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &props);
+        for (size_t i = 0; i < heapStates.size(); i++) {
+            heapStates[i].budget = budget.heapBudget[i];
+            heapStates[i].usage = budget.heapUsage[i];
+        }
+        return;
+    }
+
+    // Without the extension the whole heap is the budget and only our own
+    // allocations count as usage; memoryBudgetFraction leaves the headroom.
+    for (auto& heap : heapStates) {
+        heap.budget = heap.size;
+        heap.usage = heap.trackedUsage;
+    }
+}
+
+VkDeviceSize DeviceMemoryTracker::deviceLocalHeadroom(double fraction) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (heapStates.empty()) return 0;
+    const MemoryHeapState& heap = heapStates[primaryDeviceHeap];
+    VkDeviceSize limit = static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * fraction);
+    return limit > heap.usage ? limit - heap.usage : 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Every vkCreate*/vkAllocate* call passes gVkAllocator so host memory the
+// driver allocates on our behalf shows up in hostAllocationStats().
+extern const VkAllocationCallbacks* gVkAllocator;
+
+struct HostAllocationStats {
+    uint64_t bytes{};
+    uint64_t peakBytes{};
+    uint64_t liveAllocations{};
+    uint64_t totalAllocations{};
+    uint64_t internalBytes{};
+};
+
+HostAllocationStats hostAllocationStats();
+
+struct MemoryHeapState {
+    VkDeviceSize size{};
+    VkDeviceSize budget{};
+    VkDeviceSize usage{};        // driver-reported process usage, or trackedUsage without VK_EXT_memory_budget
+    VkDeviceSize trackedUsage{}; // allocations made through DeviceMemoryTracker
+    bool deviceLocal{};
+};
+
+// Accounts every device memory allocation per heap and combines it with the
+// budget the driver reports, so caches can size themselves against it.
+class DeviceMemoryTracker {
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, bool budgetExtension);
+    VkResult allocate(const VkMemoryAllocateInfo& info, VkDeviceMemory* memory);
+    void free(VkDeviceMemory memory);
+
+    void refresh();
+    const std::vector<MemoryHeapState>& heaps() const { return heapStates; }
+    uint32_t primaryHeap() const { return primaryDeviceHeap; }
+    bool budgetAvailable() const { return budgetExtension; }
+    // Bytes that can still be allocated on the primary device-local heap
+    // before its usage reaches fraction * budget.
+    VkDeviceSize deviceLocalHeadroom(double fraction) const;
+
+private:
+    VkPhysicalDevice physicalDevice{};
+    VkDevice device{};
+    bool budgetExtension{};
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    uint32_t primaryDeviceHeap{};
+    std::vector<MemoryHeapState> heapStates;
+    std::unordered_map<VkDeviceMemory, std::pair<uint32_t, VkDeviceSize>> allocations;
+    mutable std::mutex mutex;
+};
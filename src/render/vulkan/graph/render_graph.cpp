@@ -0,0 +1,576 @@
+#include "render/vulkan/graph/render_graph.hpp"
+#include "render/vulkan/graph/transient_placement.hpp"
+#include "core/logging.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+static const VkAccessFlags2 WRITE_ACCESS_MASK =
+    VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+static bool isWrite(VkAccessFlags2 access) {
+    return (access & WRITE_ACCESS_MASK) != 0;
+}
+
+ResourceAccess accessFor(ResourceUsage usage) {
+    switch (usage) {
+    case ResourceUsage::ComputeRead:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+    case ResourceUsage::ComputeWrite:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+    case ResourceUsage::ComputeReadWrite:
+        return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+                 VK_IMAGE_LAYOUT_GENERAL };
+    case ResourceUsage::TransferRead:
+        return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+    case ResourceUsage::TransferWrite:
+        return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+    case ResourceUsage::Present:
+        return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+    }
+    return {};
+}
+
+void RenderGraph::init(VkDevice dev, VkPhysicalDevice physical, uint32_t graphicsQueueFamily, uint32_t computeQueueFamily,
+                       PFN_vkCmdPipelineBarrier2KHR pipelineBarrier2, DeviceMemoryTracker* tracker) {
+    device = dev;
+    memoryTracker = tracker;
+    physicalDevice = physical;
+    graphicsFamily = graphicsQueueFamily;
+    computeFamily = computeQueueFamily;
+    cmdPipelineBarrier2 = pipelineBarrier2;
+}
+
+void RenderGraph::destroy() {
+    releaseTransients();
+    reset();
+}
+
+void RenderGraph::reset() {
+    resources.clear();
+    passes.clear();
+    finalBarriers[0].clear();
+    finalBarriers[1].clear();
+    crossQueueWait = 0;
+    compiledBarriers = 0;
+}
+
+GraphResource RenderGraph::importImage(const char* name, VkImage img, VkImageView view, ResourceAccess initial, ResourceAccess final) {
+    ResourceNode node;
+    node.name = name;
+    node.isImage = true;
+    node.imported = true;
+    node.image = img;
+    node.view = view;
+    node.initial = initial;
+    node.final = final;
+    node.hasFinal = true;
+    resources.push_back(node);
+    return static_cast<GraphResource>(resources.size() - 1);
+}
+
+GraphResource RenderGraph::importBuffer(const char* name, VkBuffer buf, VkDeviceSize offset, VkDeviceSize size) {
+    ResourceNode node;
+    node.name = name;
+    node.imported = true;
+    node.buffer = buf;
+    node.offset = offset;
+    node.size = size;
+    resources.push_back(node);
+    return static_cast<GraphResource>(resources.size() - 1);
+}
+
+GraphResource RenderGraph::createImage(const char* name, const ImageDesc& desc) {
+    ResourceNode node;
+    node.name = name;
+    node.isImage = true;
+    node.imageDesc = desc;
+    resources.push_back(node);
+    return static_cast<GraphResource>(resources.size() - 1);
+}
+
+GraphResource RenderGraph::createBuffer(const char* name, const BufferDesc& desc) {
+    ResourceNode node;
+    node.name = name;
+    node.bufferDesc = desc;
+    node.size = desc.size;
+    resources.push_back(node);
+    return static_cast<GraphResource>(resources.size() - 1);
+}
+
+void RenderGraph::addPass(const char* name, RenderQueue queue, std::vector<PassUse> uses, std::function<void(VkCommandBuffer)> record) {
+    PassNode pass;
+    pass.name = name;
+    pass.requested = queue;
+    pass.queue = queue;
+    pass.uses = std::move(uses);
+    pass.record = std::move(record);
+    passes.push_back(std::move(pass));
+}
+
+void RenderGraph::compile(bool asyncCompute) {
+    scheduleQueues(asyncCompute);
+    computeLifetimes();
+    realizeTransients();
+    buildBarriers();
+}
+
+void RenderGraph::scheduleQueues(bool asyncCompute) {
+    // Work is submitted compute first, then graphics, so only graphics may wait
+    // on compute. A compute pass that depends on graphics work from this frame
+    // (or on an import synchronised by the graphics submission) runs on graphics.
+    std::vector<int> lastQueue(resources.size(), -1);
+    for (size_t i = 0; i < resources.size(); i++) {
+        if (resources[i].imported && resources[i].initial.stages != 0) lastQueue[i] = static_cast<int>(RenderQueue::Graphics);
+    }
+
+    for (auto& pass : passes) {
+        pass.queue = pass.requested;
+        if (pass.queue == RenderQueue::Compute) {
+            if (!asyncCompute) pass.queue = RenderQueue::Graphics;
+            for (const auto& use : pass.uses) {
+                if (lastQueue[use.resource] == static_cast<int>(RenderQueue::Graphics)) pass.queue = RenderQueue::Graphics;
+            }
+        }
+        for (const auto& use : pass.uses) lastQueue[use.resource] = static_cast<int>(pass.queue);
+    }
+}
+
+void RenderGraph::computeLifetimes() {
+    for (size_t p = 0; p < passes.size(); p++) {
+        for (const auto& use : passes[p].uses) {
+            ResourceNode& node = resources[use.resource];
+            if (node.firstPass < 0) node.firstPass = static_cast<int>(p);
+            node.lastPass = static_cast<int>(p);
+            if (passes[p].queue == RenderQueue::Compute) node.usedOnCompute = true;
+            else node.usedOnGraphics = true;
+        }
+    }
+}
+
+void RenderGraph::releaseTransients() {
+    if (!transients.empty()) vkDeviceWaitIdle(device);
+    for (auto& t : transients) {
+        if (t.view) vkDestroyImageView(device, t.view, gVkAllocator);
+        if (t.image) vkDestroyImage(device, t.image, gVkAllocator);
+        if (t.buffer) vkDestroyBuffer(device, t.buffer, gVkAllocator);
+    }
+    for (auto memory : transientMemory) memoryTracker->free(memory);
+    transients.clear();
+    transientMemory.clear();
+    transientSignature.clear();
+    transientMemoryBytes = 0;
+    transientUnaliasedBytes = 0;
+}
+
+void RenderGraph::realizeTransients() {
+    std::vector<uint32_t> used;
+    std::string signature;
+    for (size_t i = 0; i < resources.size(); i++) {
+        const ResourceNode& node = resources[i];
+        if (node.imported || node.firstPass < 0) continue;
+        char entry[160];
+        if (node.isImage) {
+            std::snprintf(entry, sizeof(entry), "i%d,%ux%u,%u,%d-%d,%d%d;", static_cast<int>(node.imageDesc.format),
+                          node.imageDesc.extent.width, node.imageDesc.extent.height, node.imageDesc.usage,
+                          node.firstPass, node.lastPass, node.usedOnGraphics, node.usedOnCompute);
+        } else {
+            std::snprintf(entry, sizeof(entry), "b%llu,%u,%d-%d,%d%d;", static_cast<unsigned long long>(node.bufferDesc.size),
+                          node.bufferDesc.usage, node.firstPass, node.lastPass, node.usedOnGraphics, node.usedOnCompute);
+        }
+        signature += entry;
+        used.push_back(static_cast<uint32_t>(i));
+    }
+
+    // The graph is rebuilt every frame but its shape rarely changes, so the
+    // physical resources are kept for as long as the signature matches.
+    if (signature == transientSignature) {
+        for (size_t t = 0; t < used.size(); t++) resources[used[t]].transient = static_cast<uint32_t>(t);
+        return;
+    }
+
+    releaseTransients();
+    transientSignature = signature;
+    if (used.empty()) return;
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
+    uint32_t families[2] = { graphicsFamily, computeFamily };
+
+    std::vector<VkDeviceSize> alignments;
+    for (size_t t = 0; t < used.size(); t++) {
+        ResourceNode& node = resources[used[t]];
+        node.transient = static_cast<uint32_t>(t);
+        bool concurrent = node.usedOnGraphics && node.usedOnCompute && graphicsFamily != computeFamily;
+
+        Transient tr;
+        VkMemoryRequirements req{};
+        if (node.isImage) {
+            VkImageCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            info.imageType = VK_IMAGE_TYPE_2D;
+            info.format = node.imageDesc.format;
+            info.extent = { node.imageDesc.extent.width, node.imageDesc.extent.height, 1 };
+            info.mipLevels = 1;
+            info.arrayLayers = 1;
+            info.samples = VK_SAMPLE_COUNT_1_BIT;
+            info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            info.usage = node.imageDesc.usage;
+            info.sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+            info.queueFamilyIndexCount = concurrent ? 2 : 0;
+            info.pQueueFamilyIndices = concurrent ? families : nullptr;
+            info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (vkCreateImage(device, &info, gVkAllocator, &tr.image) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create render graph image");
+            }
+            vkGetImageMemoryRequirements(device, tr.image, &req);
+        } else {
+            VkBufferCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            info.size = node.bufferDesc.size;
+            info.usage = node.bufferDesc.usage;
+            info.sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+            info.queueFamilyIndexCount = concurrent ? 2 : 0;
+            info.pQueueFamilyIndices = concurrent ? families : nullptr;
+            if (vkCreateBuffer(device, &info, gVkAllocator, &tr.buffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create render graph buffer");
+            }
+            vkGetBufferMemoryRequirements(device, tr.buffer, &req);
+        }
+
+        tr.size = req.size;
+        tr.memoryType = UINT32_MAX;
+        for (uint32_t i = 0; i < memProps.memoryTypeCount && tr.memoryType == UINT32_MAX; i++) {
+            if ((req.memoryTypeBits & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+                tr.memoryType = i;
+            }
+        }
+        if (tr.memoryType == UINT32_MAX) throw std::runtime_error("Failed to find memory type for render graph resource");
+
+        alignments.push_back(std::max(req.alignment, props.limits.bufferImageGranularity));
+        transients.push_back(tr);
+    }
+
+    std::vector<TransientRequest> requests(transients.size());
+    for (size_t t = 0; t < transients.size(); t++) {
+        const ResourceNode& node = resources[used[t]];
+        TransientRequest& req = requests[t];
+        req.size = transients[t].size;
+        req.alignment = alignments[t];
+        req.memoryType = transients[t].memoryType;
+        req.firstPass = node.firstPass;
+        req.lastPass = node.lastPass;
+        req.usedOnGraphics = node.usedOnGraphics;
+        req.usedOnCompute = node.usedOnCompute;
+    }
+    std::vector<uint64_t> blockSize(memProps.memoryTypeCount, 0);
+    std::vector<TransientPlacement> placements = placeTransients(requests, blockSize);
+    for (size_t t = 0; t < transients.size(); t++) {
+        transients[t].offset = placements[t].offset;
+        transients[t].aliases = std::move(placements[t].aliases);
+        transientUnaliasedBytes += transients[t].size;
+    }
+
+    std::vector<VkDeviceMemory> memoryForType(memProps.memoryTypeCount, VK_NULL_HANDLE);
+    for (uint32_t type = 0; type < memProps.memoryTypeCount; type++) {
+        if (blockSize[type] == 0) continue;
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = blockSize[type];
+        allocInfo.memoryTypeIndex = type;
+        if (memoryTracker->allocate(allocInfo, &memoryForType[type]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate render graph memory");
+        }
+        transientMemory.push_back(memoryForType[type]);
+        transientMemoryBytes += blockSize[type];
+    }
+
+    for (size_t t = 0; t < transients.size(); t++) {
+        Transient& tr = transients[t];
+        const ResourceNode& node = resources[used[t]];
+        VkDeviceMemory memory = memoryForType[tr.memoryType];
+        if (tr.image) {
+            vkBindImageMemory(device, tr.image, memory, tr.offset);
+            if (node.imageDesc.usage & (VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)) {
+                VkImageViewCreateInfo viewInfo{};
+                viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                viewInfo.image = tr.image;
+                viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                viewInfo.format = node.imageDesc.format;
+                viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                viewInfo.subresourceRange.levelCount = 1;
+                viewInfo.subresourceRange.layerCount = 1;
+                if (vkCreateImageView(device, &viewInfo, gVkAllocator, &tr.view) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to create render graph image view");
+                }
+            }
+        } else {
+            vkBindBufferMemory(device, tr.buffer, memory, tr.offset);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(gLogMutex);
+    if (gLogFile.is_open()) {
+        char line[160];
+        std::snprintf(line, sizeof(line), "render graph: %zu transients in %.2f MB (%.2f MB without aliasing)\n",
+                      transients.size(), transientMemoryBytes / (1024.0 * 1024.0), transientUnaliasedBytes / (1024.0 * 1024.0));
+        gLogFile << line;
+        gLogFile.flush();
+    }
+}
+
+void RenderGraph::buildBarriers() {
+    struct State {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2 writeStages{};
+        VkAccessFlags2 writeAccess{};
+        VkPipelineStageFlags2 readStages{};
+        VkPipelineStageFlags2 visibleStages{};
+        VkAccessFlags2 visibleAccess{};
+        int queue = -1;
+    };
+
+    std::vector<State> states(resources.size());
+    std::vector<GraphResource> transientOwner(transients.size(), 0);
+    for (size_t i = 0; i < resources.size(); i++) {
+        const ResourceNode& node = resources[i];
+        State& st = states[i];
+        if (node.transient != UINT32_MAX) transientOwner[node.transient] = static_cast<GraphResource>(i);
+        if (!node.imported) continue;
+        st.layout = node.isImage ? node.initial.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+        if (isWrite(node.initial.access)) {
+            st.writeStages = node.initial.stages;
+            st.writeAccess = node.initial.access & WRITE_ACCESS_MASK;
+        } else {
+            st.readStages = node.initial.stages;
+        }
+        if (node.initial.stages != 0) st.queue = static_cast<int>(RenderQueue::Graphics);
+    }
+
+    for (size_t p = 0; p < passes.size(); p++) {
+        PassNode& pass = passes[p];
+        int queue = static_cast<int>(pass.queue);
+
+        std::vector<std::pair<GraphResource, ResourceAccess>> merged;
+        for (const auto& use : pass.uses) {
+            ResourceAccess acc = accessFor(use.usage);
+            auto it = std::find_if(merged.begin(), merged.end(), [&](const auto& m) { return m.first == use.resource; });
+            if (it == merged.end()) {
+                merged.push_back({ use.resource, acc });
+            } else {
+                it->second.stages |= acc.stages;
+                it->second.access |= acc.access;
+                if (it->second.layout != acc.layout) it->second.layout = VK_IMAGE_LAYOUT_GENERAL;
+            }
+        }
+
+        for (const auto& [res, acc] : merged) {
+            const ResourceNode& node = resources[res];
+            State& st = states[res];
+            bool write = isWrite(acc.access);
+            bool layoutChange = node.isImage && st.layout != acc.layout;
+
+            // First use of aliased memory waits for everything the previous
+            // occupants did; image contents start out undefined.
+            if (node.transient != UINT32_MAX && node.firstPass == static_cast<int>(p)) {
+                for (uint32_t alias : transients[node.transient].aliases) {
+                    const State& prev = states[transientOwner[alias]];
+                    st.writeStages |= prev.writeStages | prev.readStages;
+                    st.writeAccess |= prev.writeAccess;
+                }
+            }
+
+            if (st.queue >= 0 && st.queue != queue) {
+                // The semaphore between the submissions is a full dependency;
+                // only a layout change still needs a barrier on this queue.
+                crossQueueWait |= acc.stages;
+                if (layoutChange) pass.barriers.push_back({ res, { acc.stages, 0, st.layout }, acc });
+                st.layout = node.isImage ? acc.layout : st.layout;
+                st.writeStages = write ? acc.stages : 0;
+                st.writeAccess = acc.access & WRITE_ACCESS_MASK;
+                st.readStages = write ? 0 : acc.stages;
+                st.visibleStages = acc.stages;
+                st.visibleAccess = acc.access;
+                st.queue = queue;
+                continue;
+            }
+
+            if (!write && !layoutChange) {
+                bool visible = (acc.stages & ~st.visibleStages) == 0 && (acc.access & ~st.visibleAccess) == 0;
+                if (st.writeStages && !visible) {
+                    pass.barriers.push_back({ res, { st.writeStages, st.writeAccess, st.layout }, acc });
+                    st.visibleStages |= acc.stages;
+                    st.visibleAccess |= acc.access;
+                }
+                st.readStages |= acc.stages;
+                st.queue = queue;
+                continue;
+            }
+
+            VkPipelineStageFlags2 srcStages = st.writeStages | st.readStages;
+            if (srcStages || layoutChange) {
+                pass.barriers.push_back({ res, { srcStages, st.writeAccess, st.layout }, acc });
+            }
+            if (node.isImage) st.layout = acc.layout;
+            st.writeStages = acc.stages;
+            st.writeAccess = acc.access & WRITE_ACCESS_MASK;
+            st.readStages = write ? 0 : acc.stages;
+            st.visibleStages = acc.stages;
+            st.visibleAccess = acc.access;
+            st.queue = queue;
+        }
+        compiledBarriers += static_cast<uint32_t>(pass.barriers.size());
+    }
+
+    for (size_t i = 0; i < resources.size(); i++) {
+        const ResourceNode& node = resources[i];
+        if (!node.hasFinal) continue;
+        const State& st = states[i];
+        VkPipelineStageFlags2 srcStages = st.writeStages | st.readStages;
+        bool layoutChange = node.isImage && st.layout != node.final.layout;
+        if (!layoutChange && (srcStages == 0 || node.final.stages == 0)) continue;
+        int queue = st.queue >= 0 ? st.queue : static_cast<int>(RenderQueue::Graphics);
+        finalBarriers[queue].push_back({ static_cast<GraphResource>(i), { srcStages, st.writeAccess, st.layout }, node.final });
+        compiledBarriers++;
+    }
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer cmd, const std::vector<Barrier>& barriers) const {
+    if (barriers.empty()) return;
+
+    VkImageSubresourceRange range{};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.levelCount = 1;
+    range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+    if (cmdPipelineBarrier2) {
+        std::vector<VkImageMemoryBarrier2> imageBarriers;
+        std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+        for (const auto& b : barriers) {
+            if (resources[b.resource].isImage) {
+                VkImageMemoryBarrier2 barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+                barrier.srcStageMask = b.src.stages;
+                barrier.srcAccessMask = b.src.access;
+                barrier.dstStageMask = b.dst.stages;
+                barrier.dstAccessMask = b.dst.access;
+                barrier.oldLayout = b.src.layout;
+                barrier.newLayout = b.dst.layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image(b.resource);
+                barrier.subresourceRange = range;
+                imageBarriers.push_back(barrier);
+            } else {
+                VkBufferMemoryBarrier2 barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+                barrier.srcStageMask = b.src.stages;
+                barrier.srcAccessMask = b.src.access;
+                barrier.dstStageMask = b.dst.stages;
+                barrier.dstAccessMask = b.dst.access;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.buffer = buffer(b.resource);
+                barrier.offset = bufferOffset(b.resource);
+                barrier.size = resources[b.resource].size;
+                bufferBarriers.push_back(barrier);
+            }
+        }
+
+        VkDependencyInfo dependency{};
+        dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+        dependency.pBufferMemoryBarriers = bufferBarriers.data();
+        dependency.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+        dependency.pImageMemoryBarriers = imageBarriers.data();
+        cmdPipelineBarrier2(cmd, &dependency);
+        return;
+    }
+
+    // Legacy path: one call with the union of all stage masks.
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    for (const auto& b : barriers) {
+        srcStages |= static_cast<VkPipelineStageFlags>(b.src.stages);
+        dstStages |= static_cast<VkPipelineStageFlags>(b.dst.stages);
+        if (resources[b.resource].isImage) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = static_cast<VkAccessFlags>(b.src.access);
+            barrier.dstAccessMask = static_cast<VkAccessFlags>(b.dst.access);
+            barrier.oldLayout = b.src.layout;
+            barrier.newLayout = b.dst.layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image(b.resource);
+            barrier.subresourceRange = range;
+            imageBarriers.push_back(barrier);
+        } else {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = static_cast<VkAccessFlags>(b.src.access);
+            barrier.dstAccessMask = static_cast<VkAccessFlags>(b.dst.access);
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = buffer(b.resource);
+            barrier.offset = bufferOffset(b.resource);
+            barrier.size = resources[b.resource].size;
+            bufferBarriers.push_back(barrier);
+        }
+    }
+    if (srcStages == 0) srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if (dstStages == 0) dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+    vkCmdPipelineBarrier(
+        cmd,
+        srcStages,
+        dstStages,
+        0,
+        0, nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+        static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+void RenderGraph::execute(VkCommandBuffer graphicsCmd, VkCommandBuffer computeCmd) {
+    for (const auto& pass : passes) {
+        VkCommandBuffer cmd = pass.queue == RenderQueue::Compute ? computeCmd : graphicsCmd;
+        if (!cmd) throw std::runtime_error("Render graph pass scheduled on a queue without a command buffer");
+        recordBarriers(cmd, pass.barriers);
+        pass.record(cmd);
+    }
+    recordBarriers(graphicsCmd, finalBarriers[static_cast<int>(RenderQueue::Graphics)]);
+    if (computeCmd) recordBarriers(computeCmd, finalBarriers[static_cast<int>(RenderQueue::Compute)]);
+}
+
+VkImage RenderGraph::image(GraphResource r) const {
+    const ResourceNode& node = resources[r];
+    return node.imported ? node.image : transients[node.transient].image;
+}
+
+VkImageView RenderGraph::imageView(GraphResource r) const {
+    const ResourceNode& node = resources[r];
+    return node.imported ? node.view : transients[node.transient].view;
+}
+
+VkBuffer RenderGraph::buffer(GraphResource r) const {
+    const ResourceNode& node = resources[r];
+    return node.imported ? node.buffer : transients[node.transient].buffer;
+}
+
+VkDeviceSize RenderGraph::bufferOffset(GraphResource r) const {
+    const ResourceNode& node = resources[r];
+    return node.imported ? node.offset : 0;
+}
+
+bool RenderGraph::hasWork(RenderQueue queue) const {
+    for (const auto& pass : passes) {
+        if (pass.queue == queue) return true;
+    }
+    return false;
+}
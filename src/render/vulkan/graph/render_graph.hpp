@@ -0,0 +1,166 @@
+#pragma once
+
+#include "render/vulkan/core/vk_memory.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class RenderQueue : uint32_t {
+    Graphics = 0,
+    Compute = 1,
+};
+
+enum class ResourceUsage : uint32_t {
+    ComputeRead,
+    ComputeWrite,
+    ComputeReadWrite,
+    TransferRead,
+    TransferWrite,
+    Present,
+};
+
+// Stage/access masks use the synchronization2 bit values but stay within the
+// bits that also exist in the legacy enums, so the same state can be recorded
+// with vkCmdPipelineBarrier when VK_KHR_synchronization2 is unavailable.
+struct ResourceAccess {
+    VkPipelineStageFlags2 stages{};
+    VkAccessFlags2 access{};
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+ResourceAccess accessFor(ResourceUsage usage);
+
+using GraphResource = uint32_t;
+
+struct PassUse {
+    GraphResource resource;
+    ResourceUsage usage;
+};
+
+// Per-frame graph of compute/transfer passes. Passes declare what they read and
+// write; compile() schedules them onto queues, derives the minimal set of
+// barriers between them and places transient resources in shared memory when
+// their lifetimes do not overlap.
+class RenderGraph {
+public:
+    struct ImageDesc {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent{};
+        VkImageUsageFlags usage{};
+    };
+
+    struct BufferDesc {
+        VkDeviceSize size{};
+        VkBufferUsageFlags usage{};
+    };
+
+    void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsFamily, uint32_t computeFamily,
+              PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2, DeviceMemoryTracker* memoryTracker);
+    void destroy();
+
+    void reset();
+    // Imported resources are owned outside the graph. `initial` is the state the
+    // first pass has to synchronise with (e.g. the acquire semaphore wait stage),
+    // `final` the state left behind after the last pass.
+    GraphResource importImage(const char* name, VkImage image, VkImageView view, ResourceAccess initial, ResourceAccess final);
+    GraphResource importBuffer(const char* name, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+    GraphResource createImage(const char* name, const ImageDesc& desc);
+    GraphResource createBuffer(const char* name, const BufferDesc& desc);
+    void addPass(const char* name, RenderQueue queue, std::vector<PassUse> uses, std::function<void(VkCommandBuffer)> record);
+
+    void compile(bool asyncCompute);
+    // Compute passes are recorded into computeCmd when they were scheduled on the
+    // async queue; the caller submits computeCmd before graphicsCmd.
+    void execute(VkCommandBuffer graphicsCmd, VkCommandBuffer computeCmd);
+
+    VkImage image(GraphResource r) const;
+    VkImageView imageView(GraphResource r) const;
+    VkBuffer buffer(GraphResource r) const;
+    VkDeviceSize bufferOffset(GraphResource r) const;
+
+    bool hasWork(RenderQueue queue) const;
+    // Stages of the graphics submission that must wait on this frame's compute submission.
+    VkPipelineStageFlags2 graphicsWaitStages() const { return crossQueueWait; }
+    uint32_t barrierCount() const { return compiledBarriers; }
+    VkDeviceSize transientBytes() const { return transientMemoryBytes; }
+    VkDeviceSize transientBytesUnaliased() const { return transientUnaliasedBytes; }
+
+private:
+    struct Barrier {
+        GraphResource resource;
+        ResourceAccess src;
+        ResourceAccess dst;
+    };
+
+    struct ResourceNode {
+        std::string name;
+        bool isImage{};
+        bool imported{};
+        VkImage image{};
+        VkImageView view{};
+        VkBuffer buffer{};
+        VkDeviceSize offset{};
+        VkDeviceSize size = VK_WHOLE_SIZE;
+        ImageDesc imageDesc{};
+        BufferDesc bufferDesc{};
+        ResourceAccess initial{};
+        ResourceAccess final{};
+        bool hasFinal{};
+
+        int firstPass = -1;
+        int lastPass = -1;
+        bool usedOnGraphics{};
+        bool usedOnCompute{};
+        uint32_t transient = UINT32_MAX;
+    };
+
+    struct PassNode {
+        std::string name;
+        RenderQueue requested{};
+        RenderQueue queue{};
+        std::vector<PassUse> uses;
+        std::function<void(VkCommandBuffer)> record;
+        std::vector<Barrier> barriers;
+    };
+
+    struct Transient {
+        VkImage image{};
+        VkImageView view{};
+        VkBuffer buffer{};
+        VkDeviceSize size{};
+        VkDeviceSize offset{};
+        uint32_t memoryType{};
+        std::vector<uint32_t> aliases; // earlier transients sharing memory with this one
+    };
+
+    void scheduleQueues(bool asyncCompute);
+    void computeLifetimes();
+    void realizeTransients();
+    void releaseTransients();
+    void buildBarriers();
+    void recordBarriers(VkCommandBuffer cmd, const std::vector<Barrier>& barriers) const;
+
+    VkDevice device{};
+    VkPhysicalDevice physicalDevice{};
+    uint32_t graphicsFamily{};
+    uint32_t computeFamily{};
+    PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2{};
+    DeviceMemoryTracker* memoryTracker{};
+
+    std::vector<ResourceNode> resources;
+    std::vector<PassNode> passes;
+    std::vector<Barrier> finalBarriers[2];
+
+    std::vector<Transient> transients;
+    std::vector<VkDeviceMemory> transientMemory;
+    std::string transientSignature;
+
+    VkPipelineStageFlags2 crossQueueWait{};
+    uint32_t compiledBarriers{};
+    VkDeviceSize transientMemoryBytes{};
+    VkDeviceSize transientUnaliasedBytes{};
+};
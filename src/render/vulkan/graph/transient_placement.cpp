@@ -0,0 +1,67 @@
+#include "render/vulkan/graph/transient_placement.hpp"
+
+#include <algorithm>
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool canAliasTransients(const TransientRequest& a, const TransientRequest& b) {
+    if (a.memoryType != b.memoryType) return false;
+    if (a.usedOnGraphics && a.usedOnCompute) return false;
+    if (b.usedOnGraphics && b.usedOnCompute) return false;
+    if (a.usedOnCompute != b.usedOnCompute) return false;
+    return a.lastPass < b.firstPass || b.lastPass < a.firstPass;
+}
+
+std::vector<TransientPlacement> placeTransients(const std::vector<TransientRequest>& requests,
+                                                std::vector<uint64_t>& blockSizes) {
+    std::vector<TransientPlacement> placements(requests.size());
+    auto overlaps = [&](uint32_t a, uint64_t offset, uint32_t b) {
+        return offset < placements[b].offset + requests[b].size && placements[b].offset < offset + requests[a].size;
+    };
+
+    std::vector<uint32_t> order(requests.size());
+    for (size_t t = 0; t < order.size(); t++) order[t] = static_cast<uint32_t>(t);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return requests[a].size > requests[b].size; });
+
+    std::vector<uint32_t> placed;
+    for (uint32_t t : order) {
+        const TransientRequest& req = requests[t];
+        std::vector<uint64_t> candidates = { 0 };
+        for (uint32_t p : placed) {
+            if (requests[p].memoryType == req.memoryType) {
+                candidates.push_back(alignUp(placements[p].offset + requests[p].size, req.alignment));
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        uint64_t offset = 0;
+        for (uint64_t candidate : candidates) {
+            bool fits = true;
+            for (uint32_t p : placed) {
+                if (requests[p].memoryType == req.memoryType && !canAliasTransients(req, requests[p]) &&
+                    overlaps(t, candidate, p)) {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits) {
+                offset = candidate;
+                break;
+            }
+        }
+        placements[t].offset = offset;
+        placed.push_back(t);
+        if (blockSizes.size() <= req.memoryType) blockSizes.resize(req.memoryType + 1, 0);
+        blockSizes[req.memoryType] = std::max(blockSizes[req.memoryType], offset + req.size);
+    }
+
+    for (uint32_t a = 0; a < requests.size(); a++) {
+        for (uint32_t b = 0; b < requests.size(); b++) {
+            if (a == b || !canAliasTransients(requests[a], requests[b]) || !overlaps(b, placements[b].offset, a)) continue;
+            if (requests[a].lastPass < requests[b].firstPass) placements[b].aliases.push_back(a);
+        }
+    }
+    return placements;
+}
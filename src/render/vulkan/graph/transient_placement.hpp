@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// What the placement of one graph-owned resource depends on: its memory
+// requirements and the passes (in submission order) and queues that use it.
+struct TransientRequest {
+    uint64_t size{};
+    uint64_t alignment = 1;
+    uint32_t memoryType{};
+    int firstPass = -1;
+    int lastPass = -1;
+    bool usedOnGraphics{};
+    bool usedOnCompute{};
+};
+
+struct TransientPlacement {
+    uint64_t offset{};
+    std::vector<uint32_t> aliases; // earlier transients sharing memory with this one
+};
+
+// Two transients may share memory when they live on the same single queue
+// and their pass intervals do not overlap.
+bool canAliasTransients(const TransientRequest& a, const TransientRequest& b);
+
+// Places each transient in its memory type's block, largest first, at the
+// lowest offset where it overlaps nothing it cannot alias. `blockSizes[type]`
+// is set to the size the block for that memory type needs.
+std::vector<TransientPlacement> placeTransients(const std::vector<TransientRequest>& requests,
+                                                std::vector<uint64_t>& blockSizes);
@@ -0,0 +1,125 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <future>
+
+// The render loop keeps its last FLIGHT_RECORDER_FRAMES iterations in a ring.
+// An iteration over the hitch threshold is dumped one frame later, once its
+// GPU times are in, together with the FLIGHT_RECORDER_SECONDS before it. The
+// file is written on a worker thread so the dump does not cause the next
+// hitch, and at most once per cooldown.
+//
+// The spike is put on whichever took most of the iteration: waiting for the
+// GPU (the fence of the frame before), acquire, present (the present call
+// plus present_wait), or the CPU (everything else; the limiter is excluded).
+
+static const char* hitchCause(const FrameRecord& r, double& causeMs) {
+    double present = r.presentWaitMs + r.presentMs;
+    double cpu = std::max(0.0, r.frameMs - r.fenceMs - r.acquireMs - present - r.limiterMs);
+    const char* cause = "cpu";
+    causeMs = cpu;
+    if (r.fenceMs > causeMs) {
+        cause = "gpu";
+        causeMs = r.fenceMs;
+    }
+    if (r.acquireMs > causeMs) {
+        cause = "acquire";
+        causeMs = r.acquireMs;
+    }
+    if (present > causeMs) {
+        cause = "present";
+        causeMs = present;
+    }
+    return cause;
+}
+
+static void writeHitchDump(const std::string& path, const FrameRecord& hitch, const char* cause, double causeMs,
+                           double thresholdMs, const std::vector<FrameRecord>& frames) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) return;
+
+    char buf[512];
+    std::snprintf(buf, sizeof(buf),
+                  "{\n  \"frame\": %llu,\n  \"frame_ms\": %.3f,\n  \"threshold_ms\": %.3f,\n  \"cause\": \"%s\",\n  \"cause_ms\": %.3f,\n",
+                  static_cast<unsigned long long>(hitch.index), hitch.frameMs, thresholdMs, cause, causeMs);
+    out << buf;
+    out << "  \"frames\": [";
+    for (size_t i = 0; i < frames.size(); i++) {
+        const FrameRecord& r = frames[i];
+        std::snprintf(buf, sizeof(buf),
+                      "%s\n    { \"frame\": %llu, \"t\": %.4f, \"frame_ms\": %.3f, \"fence_ms\": %.3f, \"present_wait_ms\": %.3f, "
+                      "\"limiter_ms\": %.3f, \"acquire_ms\": %.3f, \"update_ms\": %.3f, \"record_ms\": %.3f, \"submit_ms\": %.3f, "
+                      "\"present_ms\": %.3f, \"gpu_raymarch_ms\": %.3f, \"gpu_height_cache_ms\": %.3f,",
+                      i ? "," : "", static_cast<unsigned long long>(r.index), r.time - hitch.time, r.frameMs, r.fenceMs,
+                      r.presentWaitMs, r.limiterMs, r.acquireMs, r.updateMs, r.recordMs, r.submitMs, r.presentMs,
+                      r.gpuRaymarchMs, r.gpuHeightCacheMs);
+        out << buf;
+        std::snprintf(buf, sizeof(buf),
+                      " \"camera\": [%.2f, %.2f, %.2f], \"forward\": [%.3f, %.3f, %.3f], \"height_cache_update\": %s, "
+                      "\"history_valid\": %s, \"far_valid\": %s, \"refine_samples\": %u }",
+                      r.cameraPos.x, r.cameraPos.y, r.cameraPos.z, r.cameraForward.x, r.cameraForward.y, r.cameraForward.z,
+                      r.heightCacheUpdate ? "true" : "false", r.historyValid ? "true" : "false", r.farValid ? "true" : "false",
+                      r.refineSamples);
+        out << buf;
+    }
+    out << "\n  ]\n}\n";
+}
+
+void VulkanAppImpl::commitFrameRecord(double start, double seconds) {
+    if (frameRing.empty()) frameRing.resize(FLIGHT_RECORDER_FRAMES);
+
+    // The previous iteration's GPU times arrived during this one.
+    if (pendingHitch >= 0) {
+        dumpHitch(frameRing[static_cast<uint64_t>(pendingHitch) % frameRing.size()]);
+        pendingHitch = -1;
+    }
+
+    currentFrame.index = framesRecorded;
+    currentFrame.time = start;
+    currentFrame.frameMs = seconds * 1000.0;
+    frameRing[framesRecorded % frameRing.size()] = currentFrame;
+    framesRecorded++;
+
+    bool slow = options.hitchThresholdMs > 0.0 && currentFrame.frameMs > options.hitchThresholdMs;
+    bool dumping = hitchDumpTask.valid() && hitchDumpTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    // The first iteration includes pipeline warm-up and is not a hitch.
+    if (slow && currentFrame.index > 0 && !dumping && start - lastHitchDump >= HITCH_DUMP_COOLDOWN_SECONDS) {
+        pendingHitch = static_cast<int64_t>(currentFrame.index);
+        lastHitchDump = start;
+    }
+    currentFrame = {};
+}
+
+FrameRecord* VulkanAppImpl::lastFrameRecord() {
+    if (frameRing.empty() || framesRecorded == 0) return nullptr;
+    return &frameRing[(framesRecorded - 1) % frameRing.size()];
+}
+
+void VulkanAppImpl::dumpHitch(const FrameRecord& hitch) {
+    std::vector<FrameRecord> frames;
+    uint64_t count = std::min<uint64_t>(framesRecorded, frameRing.size());
+    for (uint64_t i = framesRecorded - count; i < framesRecorded; i++) {
+        const FrameRecord& r = frameRing[i % frameRing.size()];
+        if (hitch.time - r.time <= FLIGHT_RECORDER_SECONDS) frames.push_back(r);
+    }
+
+    double causeMs = 0.0;
+    const char* cause = hitchCause(hitch, causeMs);
+    std::string path = options.hitchOutput + "_" + std::to_string(hitch.index) + ".json";
+    double threshold = options.hitchThresholdMs;
+    {
+        std::lock_guard<std::mutex> lock(gLogMutex);
+        if (gLogFile.is_open()) {
+            char line[256];
+            std::snprintf(line, sizeof(line), "hitch: frame %llu took %.1f ms, %s %.1f ms, %zu frames dumped to %s\n",
+                          static_cast<unsigned long long>(hitch.index), hitch.frameMs, cause, causeMs, frames.size(), path.c_str());
+            gLogFile << line;
+            gLogFile.flush();
+        }
+    }
+    hitchDumpTask = std::async(std::launch::async, [path, hitch, cause, causeMs, threshold, frames = std::move(frames)] {
+        writeHitchDump(path, hitch, cause, causeMs, threshold, frames);
+    });
+}
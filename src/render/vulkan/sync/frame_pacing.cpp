@@ -0,0 +1,66 @@
+#include "render/vulkan/app/vulkan_app_impl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// Everything that can block the render loop runs before the newest camera
+// snapshot is picked up, so the state recorded into a frame is as fresh as
+// possible:
+//   1. the previous frame's fence (GPU done),
+//   2. with VK_KHR_present_wait, the previous frame reaching the display,
+//   3. the frame limiter.
+// Input-to-present latency is measured from the input thread sampling the
+// camera the frame used to the present completing (present_wait) or, without
+// it, to the GPU finishing the frame, which underestimates by whatever the
+// presentation engine queues.
+
+void VulkanAppImpl::waitForNextFrame() {
+    double start = glfwGetTime();
+    {
+        PROFILE_ZONE("wait fence");
+        vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT64_MAX);
+    }
+    double completed = glfwGetTime();
+    currentFrame.fenceMs = (completed - start) * 1000.0;
+
+    if (waitForPresent && presentIdValue > 0) {
+        PROFILE_ZONE("wait present");
+        double waitStart = glfwGetTime();
+        VkResult result = waitForPresent(device, swapchain, presentIdValue, PRESENT_WAIT_TIMEOUT_NS);
+        if (result == VK_SUCCESS) completed = glfwGetTime();
+        currentFrame.presentWaitMs = (glfwGetTime() - waitStart) * 1000.0;
+    }
+
+    if (latencyPendingInput >= 0.0) {
+        double ms = (completed - latencyPendingInput) * 1000.0;
+        latencyAccumMs += ms;
+        latencyFrames += 1;
+        if (benchmarkRecording) benchmarkStats.latencyMs.push_back(ms);
+        metrics.latencyMs->observe(ms);
+        latencyPendingInput = -1.0;
+    }
+    // The camera predictor's estimate of the delay from picking up a snapshot
+    // to the frame being displayed, with the same caveat without present_wait.
+    if (latencyPendingRead >= 0.0) {
+        double delay = completed - latencyPendingRead;
+        displayDelay = displayDelay > 0.0 ? displayDelay + DISPLAY_DELAY_SMOOTHING * (delay - displayDelay) : delay;
+        latencyPendingRead = -1.0;
+    }
+
+    if (options.frameLimit <= 0.0) return;
+    PROFILE_ZONE("frame limiter");
+
+    // Sleep most of the remaining interval and spin the last bit; sleep_for
+    // routinely overshoots by a millisecond or more.
+    double interval = 1.0 / options.frameLimit;
+    double now = glfwGetTime();
+    if (nextFrameTime <= 0.0 || now - nextFrameTime > interval) nextFrameTime = now;
+    double remaining = nextFrameTime - now;
+    if (remaining > FRAME_LIMIT_SPIN_SECONDS) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(remaining - FRAME_LIMIT_SPIN_SECONDS));
+    }
+    while (glfwGetTime() < nextFrameTime) {}
+    nextFrameTime += interval;
+    currentFrame.limiterMs = (glfwGetTime() - now) * 1000.0;
+}
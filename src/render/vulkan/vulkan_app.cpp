@@ -2,8 +2,8 @@
 #include "render/vulkan/vulkan_app.hpp"
 #include "render/vulkan/app/vulkan_app_impl.hpp"
 
-VulkanApp::VulkanApp(bool enableValidation)
-    : impl(new VulkanAppImpl(enableValidation)) {}
+VulkanApp::VulkanApp(const AppOptions& options)
+    : impl(new VulkanAppImpl(options)) {}
 
 VulkanApp::~VulkanApp() { delete impl; }
 
@@ -1,10 +1,11 @@
 #pragma once
 
 class VulkanAppImpl;
+struct AppOptions;
 
 class VulkanApp {
 public:
-    explicit VulkanApp(bool enableValidation);
+    explicit VulkanApp(const AppOptions& options);
     ~VulkanApp();
 
     void run();
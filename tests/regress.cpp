@@ -0,0 +1,346 @@
+// Comparison side of the regression tests (see CMakeLists.txt): checks an
+// image the engine rendered against its golden image, and render stats
+// against a stored baseline. Exits 0 on a pass and 1 on a regression or a
+// missing reference; `skip` exits SKIP_CODE for tests that cannot run here.
+//
+//   voxel_regress image <actual.png> <golden.png> [diff.ppm]
+//   voxel_regress stats <actual.json> <baseline.txt>
+//   voxel_regress bless-stats <actual.json> <baseline.txt>
+//   voxel_regress skip <reason>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const int SKIP_CODE = 77;
+
+// Images pass when the mean colour difference stays under MAX_MEAN_DELTA_E
+// and no more than MAX_BAD_FRACTION of the pixels differ by more than
+// MAX_PIXEL_DELTA_E (CIE76 on 3x3-averaged CIELAB, 2.3 is about a just
+// noticeable difference). Averaging first forgives single-pixel sampling noise
+// but not a shifted edge or a changed colour.
+static const double MAX_MEAN_DELTA_E = 1.0;
+static const double MAX_PIXEL_DELTA_E = 10.0;
+static const double MAX_BAD_FRACTION = 0.005;
+
+// What bless-stats writes for each metric: step counts are deterministic, GPU
+// times on a software rasterizer are not.
+struct BlessRule {
+    const char* metric;
+    double tolerance;
+};
+static const BlessRule BLESS_RULES[] = {
+    { "steps_per_ray", 0.02 },
+    { "coarse_steps_per_ray", 0.02 },
+    { "fine_steps_per_ray", 0.02 },
+    { "gpu_raymarch_ms_p50", 0.25 },
+    { "gpu_raymarch_ms_p95", 0.35 },
+};
+
+struct Image {
+    uint32_t width{};
+    uint32_t height{};
+    std::vector<uint8_t> rgb;
+};
+
+static uint32_t readBigEndian(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+// Reads what encodePng writes: 8-bit RGB, unfiltered scanlines in stored
+// deflate blocks. Anything else is reported rather than decoded.
+static bool readPng(const std::string& path, Image& image, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (file.size() < 8 || std::memcmp(file.data(), signature, 8) != 0) {
+        error = path + " is not a PNG";
+        return false;
+    }
+
+    std::vector<uint8_t> zlib;
+    for (size_t pos = 8; pos + 12 <= file.size();) {
+        uint32_t length = readBigEndian(&file[pos]);
+        if (pos + 12 + length > file.size()) break;
+        const char* type = reinterpret_cast<const char*>(&file[pos + 4]);
+        const uint8_t* data = &file[pos + 8];
+        if (std::memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+            image.width = readBigEndian(data);
+            image.height = readBigEndian(data + 4);
+            if (data[8] != 8 || data[9] != 2 || data[12] != 0) {
+                error = path + " is not an 8-bit RGB PNG written by the engine";
+                return false;
+            }
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            zlib.insert(zlib.end(), data, data + length);
+        }
+        pos += 12 + length;
+    }
+
+    std::vector<uint8_t> scanlines;
+    size_t pos = 2;
+    for (bool final = false; !final;) {
+        if (pos + 5 > zlib.size() || (zlib[pos] & 0x06) != 0) {
+            error = path + " uses compressed deflate blocks; goldens must be written by the engine";
+            return false;
+        }
+        final = (zlib[pos] & 1) != 0;
+        size_t len = zlib[pos + 1] | (size_t(zlib[pos + 2]) << 8);
+        pos += 5;
+        if (pos + len > zlib.size()) {
+            error = path + " is truncated";
+            return false;
+        }
+        scanlines.insert(scanlines.end(), zlib.begin() + pos, zlib.begin() + pos + len);
+        pos += len;
+    }
+
+    size_t stride = size_t(image.width) * 3 + 1;
+    if (image.width == 0 || scanlines.size() != stride * image.height) {
+        error = path + " has unexpected image data size";
+        return false;
+    }
+    image.rgb.resize(size_t(image.width) * image.height * 3);
+    for (uint32_t y = 0; y < image.height; y++) {
+        if (scanlines[y * stride] != 0) {
+            error = path + " uses scanline filters; goldens must be written by the engine";
+            return false;
+        }
+        std::memcpy(&image.rgb[size_t(y) * image.width * 3], &scanlines[y * stride + 1], stride - 1);
+    }
+    return true;
+}
+
+static double srgbToLinear(double c) {
+    return c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+}
+
+static double labCurve(double t) {
+    return t > 216.0 / 24389.0 ? std::cbrt(t) : (24389.0 / 27.0 * t + 16.0) / 116.0;
+}
+
+// CIELAB (D65) per pixel, averaged over each pixel's 3x3 neighbourhood.
+static std::vector<double> blurredLab(const Image& image) {
+    size_t count = size_t(image.width) * image.height;
+    std::vector<double> lab(count * 3);
+    for (size_t i = 0; i < count; i++) {
+        double r = srgbToLinear(image.rgb[i * 3 + 0] / 255.0);
+        double g = srgbToLinear(image.rgb[i * 3 + 1] / 255.0);
+        double b = srgbToLinear(image.rgb[i * 3 + 2] / 255.0);
+        double x = labCurve((0.4124 * r + 0.3576 * g + 0.1805 * b) / 0.95047);
+        double y = labCurve(0.2126 * r + 0.7152 * g + 0.0722 * b);
+        double z = labCurve((0.0193 * r + 0.1192 * g + 0.9505 * b) / 1.08883);
+        lab[i * 3 + 0] = 116.0 * y - 16.0;
+        lab[i * 3 + 1] = 500.0 * (x - y);
+        lab[i * 3 + 2] = 200.0 * (y - z);
+    }
+
+    std::vector<double> blurred(lab.size());
+    int w = static_cast<int>(image.width);
+    int h = static_cast<int>(image.height);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            double sum[3] = {};
+            int n = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int sx = x + dx;
+                    int sy = y + dy;
+                    if (sx < 0 || sy < 0 || sx >= w || sy >= h) continue;
+                    const double* p = &lab[(size_t(sy) * w + sx) * 3];
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                    n++;
+                }
+            }
+            double* out = &blurred[(size_t(y) * w + x) * 3];
+            out[0] = sum[0] / n;
+            out[1] = sum[1] / n;
+            out[2] = sum[2] / n;
+        }
+    }
+    return blurred;
+}
+
+// Red where a pixel is over the per-pixel limit, grey scaled by the difference elsewhere.
+static void writeDiff(const std::string& path, const Image& image, const std::vector<double>& deltaE) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) return;
+    out << "P6\n" << image.width << " " << image.height << "\n255\n";
+    for (double d : deltaE) {
+        uint8_t grey = static_cast<uint8_t>(std::min(d / MAX_PIXEL_DELTA_E, 1.0) * 160.0);
+        uint8_t pixel[3] = { grey, grey, grey };
+        if (d > MAX_PIXEL_DELTA_E) {
+            pixel[0] = 255;
+            pixel[1] = 0;
+            pixel[2] = 0;
+        }
+        out.write(reinterpret_cast<const char*>(pixel), 3);
+    }
+}
+
+static int compareImages(const std::string& actualPath, const std::string& goldenPath, const std::string& diffPath) {
+    std::ifstream golden(goldenPath);
+    if (!golden.is_open()) {
+        std::printf("FAIL: no golden image %s; build the bless_goldens target to create it\n", goldenPath.c_str());
+        return 1;
+    }
+    Image actual;
+    Image expected;
+    std::string error;
+    if (!readPng(actualPath, actual, error) || !readPng(goldenPath, expected, error)) {
+        std::printf("FAIL: %s\n", error.c_str());
+        return 1;
+    }
+    if (actual.width != expected.width || actual.height != expected.height) {
+        std::printf("FAIL: %s is %ux%u, the golden image %ux%u\n", actualPath.c_str(), actual.width, actual.height,
+                    expected.width, expected.height);
+        return 1;
+    }
+
+    std::vector<double> a = blurredLab(actual);
+    std::vector<double> b = blurredLab(expected);
+    size_t count = size_t(actual.width) * actual.height;
+    std::vector<double> deltaE(count);
+    double sum = 0.0;
+    double worst = 0.0;
+    size_t bad = 0;
+    for (size_t i = 0; i < count; i++) {
+        double dl = a[i * 3] - b[i * 3];
+        double da = a[i * 3 + 1] - b[i * 3 + 1];
+        double db = a[i * 3 + 2] - b[i * 3 + 2];
+        deltaE[i] = std::sqrt(dl * dl + da * da + db * db);
+        sum += deltaE[i];
+        worst = std::max(worst, deltaE[i]);
+        if (deltaE[i] > MAX_PIXEL_DELTA_E) bad++;
+    }
+    double mean = sum / static_cast<double>(count);
+    double badFraction = static_cast<double>(bad) / static_cast<double>(count);
+    bool pass = mean <= MAX_MEAN_DELTA_E && badFraction <= MAX_BAD_FRACTION;
+    std::printf("%s: mean dE %.3f (max %.2f), %.3f%% of pixels over dE %.1f (max %.3f%%), worst dE %.1f\n",
+                pass ? "PASS" : "FAIL", mean, MAX_MEAN_DELTA_E, badFraction * 100.0, MAX_PIXEL_DELTA_E,
+                MAX_BAD_FRACTION * 100.0, worst);
+    if (!pass && !diffPath.empty()) {
+        writeDiff(diffPath, actual, deltaE);
+        std::printf("difference image written to %s\n", diffPath.c_str());
+    }
+    return pass ? 0 : 1;
+}
+
+// The render stats file has one flat number per key.
+static bool readStat(const std::string& json, const std::string& key, double& value) {
+    size_t pos = json.find("\"" + key + "\"");
+    if (pos == std::string::npos) return false;
+    pos = json.find(':', pos);
+    if (pos == std::string::npos) return false;
+    return std::sscanf(json.c_str() + pos + 1, "%lf", &value) == 1;
+}
+
+static bool readText(const std::string& path, std::string& text) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    text = buffer.str();
+    return true;
+}
+
+// Baseline lines are "metric value tolerance"; a metric regresses when it
+// exceeds value * (1 + tolerance). Getting much better is reported so the
+// baseline can be tightened, but does not fail.
+static int compareStats(const std::string& actualPath, const std::string& baselinePath) {
+    std::ifstream baseline(baselinePath);
+    if (!baseline.is_open()) {
+        std::printf("FAIL: no baseline %s; build the bless_goldens target to create it\n", baselinePath.c_str());
+        return 1;
+    }
+    std::string json;
+    if (!readText(actualPath, json)) {
+        std::printf("FAIL: cannot read %s\n", actualPath.c_str());
+        return 1;
+    }
+
+    bool pass = true;
+    std::string line;
+    while (std::getline(baseline, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        std::istringstream fields(line);
+        std::string metric;
+        double expected = 0.0;
+        double tolerance = 0.0;
+        if (!(fields >> metric >> expected >> tolerance)) {
+            std::printf("FAIL: cannot parse baseline line \"%s\"\n", line.c_str());
+            pass = false;
+            continue;
+        }
+        double actual = 0.0;
+        if (!readStat(json, metric, actual)) {
+            std::printf("FAIL: %s missing from %s\n", metric.c_str(), actualPath.c_str());
+            pass = false;
+            continue;
+        }
+        double limit = expected * (1.0 + tolerance);
+        const char* verdict = "ok";
+        if (actual > limit) {
+            verdict = "REGRESSION";
+            pass = false;
+        } else if (actual < expected * (1.0 - tolerance)) {
+            verdict = "improved, consider re-blessing";
+        }
+        std::printf("%-24s %12.4f baseline %12.4f limit %12.4f  %s\n", metric.c_str(), actual, expected, limit, verdict);
+    }
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
+
+static int blessStats(const std::string& actualPath, const std::string& baselinePath) {
+    std::string json;
+    if (!readText(actualPath, json)) {
+        std::printf("cannot read %s\n", actualPath.c_str());
+        return 1;
+    }
+    std::ofstream out(baselinePath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::printf("cannot write %s\n", baselinePath.c_str());
+        return 1;
+    }
+    out << "# metric baseline tolerance; fails above baseline * (1 + tolerance)\n";
+    for (const BlessRule& rule : BLESS_RULES) {
+        double value = 0.0;
+        if (!readStat(json, rule.metric, value)) continue;
+        char line[128];
+        std::snprintf(line, sizeof(line), "%s %.4f %.2f\n", rule.metric, value, rule.tolerance);
+        out << line;
+    }
+    std::printf("baseline written to %s\n", baselinePath.c_str());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "image" && (argc == 4 || argc == 5)) return compareImages(argv[2], argv[3], argc == 5 ? argv[4] : "");
+    if (mode == "stats" && argc == 4) return compareStats(argv[2], argv[3]);
+    if (mode == "bless-stats" && argc == 4) return blessStats(argv[2], argv[3]);
+    if (mode == "skip" && argc == 3) {
+        std::printf("SKIP: %s\n", argv[2]);
+        return SKIP_CODE;
+    }
+    std::printf("usage: voxel_regress image <actual.png> <golden.png> [diff.ppm]\n"
+                "       voxel_regress stats <actual.json> <baseline.txt>\n"
+                "       voxel_regress bless-stats <actual.json> <baseline.txt>\n"
+                "       voxel_regress skip <reason>\n");
+    return 2;
+}
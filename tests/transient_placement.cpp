@@ -0,0 +1,72 @@
+// Unit test for the render graph's transient placement (see
+// src/render/vulkan/graph/transient_placement.hpp). Exits 0 when every case
+// passes and 1 otherwise.
+
+#include "render/vulkan/graph/transient_placement.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+static const uint64_t MB = 1024 * 1024;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    std::printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) failures++;
+}
+
+static TransientRequest request(uint64_t size, int firstPass, int lastPass, bool compute) {
+    TransientRequest r;
+    r.size = size;
+    r.alignment = 64 * 1024;
+    r.firstPass = firstPass;
+    r.lastPass = lastPass;
+    r.usedOnGraphics = !compute;
+    r.usedOnCompute = compute;
+    return r;
+}
+
+int main() {
+    {
+        // Written by pass 0 and read by pass 1, then written by pass 2 and read by pass 3.
+        std::vector<TransientRequest> requests = { request(8 * MB, 0, 1, false), request(8 * MB, 2, 3, false) };
+        std::vector<uint64_t> blocks;
+        std::vector<TransientPlacement> placed = placeTransients(requests, blocks);
+        expect(placed[0].offset == 0 && placed[1].offset == 0, "disjoint lifetimes share offset 0");
+        expect(blocks.size() == 1 && blocks[0] == 8 * MB, "disjoint lifetimes need one resource's memory");
+        expect(placed[1].aliases.size() == 1 && placed[1].aliases[0] == 0 && placed[0].aliases.empty(),
+               "the later transient waits on the earlier one");
+    }
+    {
+        std::vector<TransientRequest> requests = { request(8 * MB, 0, 2, false), request(4 * MB, 1, 3, false) };
+        std::vector<uint64_t> blocks;
+        std::vector<TransientPlacement> placed = placeTransients(requests, blocks);
+        expect(placed[0].offset == 0 && placed[1].offset == 8 * MB, "overlapping lifetimes are placed side by side");
+        expect(blocks[0] == 12 * MB, "overlapping lifetimes need both resources' memory");
+    }
+    {
+        std::vector<TransientRequest> requests = { request(8 * MB, 0, 1, false), request(8 * MB, 2, 3, true) };
+        std::vector<uint64_t> blocks;
+        std::vector<TransientPlacement> placed = placeTransients(requests, blocks);
+        expect(placed[0].offset != placed[1].offset, "transients on different queues never alias");
+    }
+    {
+        std::vector<TransientRequest> requests = { request(8 * MB, 0, 1, false), request(8 * MB, 2, 3, false) };
+        requests[1].memoryType = 1;
+        std::vector<uint64_t> blocks;
+        placeTransients(requests, blocks);
+        expect(blocks.size() == 2 && blocks[0] == 8 * MB && blocks[1] == 8 * MB, "each memory type gets its own block");
+    }
+    {
+        // A small transient alive during both large ones goes after them, aligned.
+        std::vector<TransientRequest> requests = { request(8 * MB, 0, 1, false), request(8 * MB, 2, 3, false),
+                                                   request(1000, 0, 3, false) };
+        std::vector<uint64_t> blocks;
+        std::vector<TransientPlacement> placed = placeTransients(requests, blocks);
+        expect(placed[0].offset == 0 && placed[1].offset == 0 && placed[2].offset == 8 * MB,
+               "a long-lived transient does not overlap aliased ones");
+    }
+    return failures == 0 ? 0 : 1;
+}